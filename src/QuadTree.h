@@ -0,0 +1,2458 @@
+#pragma once
+#include <atomic>
+#include <bit>
+#include <concepts>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <numeric>
+#include <optional>
+#include <queue>
+#include <ranges>
+#include <span>
+#include <thread>
+#if defined(__AVX__) || defined(__SSE__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+#include "olcPixelGameEngine.h"
+
+namespace olc {
+struct rect {
+  olc::vf2d pos; // generic 2d float vector
+  olc::vf2d size;
+
+  rect(const olc::vf2d &p = {0.0f, 0.0f}, const olc::vf2d &s = {1.0f, 1.0f}) : pos(p), size(s) {}
+
+  [[nodiscard]] constexpr bool containsPoint(const olc::vf2d &p) const {
+    return !(p.x < pos.x || p.y < pos.y || p.x >= pos.x + size.x || p.y >= pos.y + size.y);
+  }
+
+  [[nodiscard]] constexpr bool containsRect(const olc::rect &r) const {
+    return (r.pos.x >= pos.x) && (r.pos.x + r.size.x < pos.x + size.x) && (r.pos.y >= pos.y)
+        && (r.pos.y + r.size.y < pos.y + size.y);
+  }
+
+  [[nodiscard]] constexpr bool overlaps(const olc::rect &r) const {
+    return (pos.x < r.pos.x + r.size.x && pos.x + size.x >= r.pos.x && pos.y < r.pos.y + r.size.y
+        && pos.y + size.y >= r.pos.y);
+  }
+};
+}
+
+// Widest overlap test the target supports: AVX tests 8 items per instruction, SSE and NEON 4
+#if defined(__AVX__)
+constexpr size_t OVERLAP_LANES = 8;
+#elif defined(__SSE__) || (defined(__ARM_NEON) && defined(__aarch64__))
+constexpr size_t OVERLAP_LANES = 4;
+#else
+constexpr size_t OVERLAP_LANES = 1;
+#endif
+
+// Bit i is set when item i of the OVERLAP_LANES items at the given pointers overlaps the query
+// box. Uses the same comparisons as olc::rect::overlaps, so it reports exactly the same hits.
+inline uint32_t overlap_mask(const float *pMinX, const float *pMinY, const float *pMaxX, const float *pMaxY,
+                             float qMinX, float qMinY, float qMaxX, float qMaxY) {
+#if defined(__AVX__)
+  __m256 x = _mm256_and_ps(_mm256_cmp_ps(_mm256_set1_ps(qMinX), _mm256_loadu_ps(pMaxX), _CMP_LT_OQ),
+                           _mm256_cmp_ps(_mm256_set1_ps(qMaxX), _mm256_loadu_ps(pMinX), _CMP_GE_OQ));
+  __m256 y = _mm256_and_ps(_mm256_cmp_ps(_mm256_set1_ps(qMinY), _mm256_loadu_ps(pMaxY), _CMP_LT_OQ),
+                           _mm256_cmp_ps(_mm256_set1_ps(qMaxY), _mm256_loadu_ps(pMinY), _CMP_GE_OQ));
+  return uint32_t(_mm256_movemask_ps(_mm256_and_ps(x, y)));
+#elif defined(__SSE__)
+  __m128 x = _mm_and_ps(_mm_cmplt_ps(_mm_set1_ps(qMinX), _mm_loadu_ps(pMaxX)),
+                        _mm_cmpge_ps(_mm_set1_ps(qMaxX), _mm_loadu_ps(pMinX)));
+  __m128 y = _mm_and_ps(_mm_cmplt_ps(_mm_set1_ps(qMinY), _mm_loadu_ps(pMaxY)),
+                        _mm_cmpge_ps(_mm_set1_ps(qMaxY), _mm_loadu_ps(pMinY)));
+  return uint32_t(_mm_movemask_ps(_mm_and_ps(x, y)));
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+  uint32x4_t x = vandq_u32(vcltq_f32(vdupq_n_f32(qMinX), vld1q_f32(pMaxX)),
+                           vcgeq_f32(vdupq_n_f32(qMaxX), vld1q_f32(pMinX)));
+  uint32x4_t y = vandq_u32(vcltq_f32(vdupq_n_f32(qMinY), vld1q_f32(pMaxY)),
+                           vcgeq_f32(vdupq_n_f32(qMaxY), vld1q_f32(pMinY)));
+  static const uint32_t nLaneBit[4] = {1, 2, 4, 8};
+  return vaddvq_u32(vandq_u32(vandq_u32(x, y), vld1q_u32(nLaneBit)));
+#else
+  return (qMinX < *pMaxX && qMaxX >= *pMinX && qMinY < *pMaxY && qMaxY >= *pMinY) ? 1u : 0u;
+#endif
+}
+
+// Items held by one quadtree node, kept as structure-of-arrays so the overlap scan can use
+// overlap_mask() on several items at once instead of testing one olc::rect at a time. The
+// bounds, handles and items share a single allocation of nCapacity slots each.
+template<typename Type>
+struct NodeItems {
+  float *vMinX = nullptr, *vMinY = nullptr, *vMaxX = nullptr, *vMaxY = nullptr;
+  uint32_t *vHandle = nullptr; // handle the tree gave each item, so moving an item can update its location
+  Type *vItem = nullptr;
+  uint32_t nSize = 0, nCapacity = 0;
+
+  NodeItems() = default;
+  NodeItems(const NodeItems &other) {
+    reserve(other.nSize);
+    for (size_t i = 0; i < other.nSize; i++)
+      push_back(other.vMinX[i], other.vMinY[i], other.vMaxX[i], other.vMaxY[i], other.vItem[i], other.vHandle[i]);
+  }
+  NodeItems(NodeItems &&other) noexcept { swap(other); }
+  NodeItems &operator=(NodeItems other) noexcept {
+    swap(other);
+    return *this;
+  }
+  ~NodeItems() {
+    clear();
+    ::operator delete(vMinX, ALIGNMENT);
+  }
+
+  void swap(NodeItems &other) noexcept {
+    std::swap(vMinX, other.vMinX);
+    std::swap(vMinY, other.vMinY);
+    std::swap(vMaxX, other.vMaxX);
+    std::swap(vMaxY, other.vMaxY);
+    std::swap(vHandle, other.vHandle);
+    std::swap(vItem, other.vItem);
+    std::swap(nSize, other.nSize);
+    std::swap(nCapacity, other.nCapacity);
+  }
+
+  size_t size() const { return nSize; }
+  bool empty() const { return nSize == 0; }
+
+  // Destroys the items but keeps the allocation
+  void clear() {
+    std::destroy_n(vItem, nSize);
+    nSize = 0;
+  }
+
+  void reserve(size_t n) {
+    if (n <= nCapacity) return;
+    NodeItems grown;
+    grown.allocate(n);
+    for (size_t i = 0; i < nSize; i++)
+      grown.push_back(vMinX[i], vMinY[i], vMaxX[i], vMaxY[i], std::move(vItem[i]), vHandle[i]);
+    swap(grown);
+  }
+
+  void push_back(const olc::rect &rArea, const Type &item, uint32_t nHandle) {
+    push_back(rArea.pos.x, rArea.pos.y, rArea.pos.x + rArea.size.x, rArea.pos.y + rArea.size.y, item, nHandle);
+  }
+
+  template<typename Item>
+  void push_back(float fMinX, float fMinY, float fMaxX, float fMaxY, Item &&item, uint32_t nHandle) {
+    if (nSize == nCapacity) reserve(std::max<size_t>(4, 2 * size_t(nCapacity)));
+    vMinX[nSize] = fMinX;
+    vMinY[nSize] = fMinY;
+    vMaxX[nSize] = fMaxX;
+    vMaxY[nSize] = fMaxY;
+    vHandle[nSize] = nHandle;
+    new (&vItem[nSize]) Type(std::forward<Item>(item));
+    nSize++;
+  }
+
+  void set_bounds(size_t i, float fMinX, float fMinY, float fMaxX, float fMaxY) {
+    vMinX[i] = fMinX;
+    vMinY[i] = fMinY;
+    vMaxX[i] = fMaxX;
+    vMaxY[i] = fMaxY;
+  }
+
+  // Removes item i by moving the last item into its slot
+  void erase(size_t i) {
+    const size_t nLast = nSize - 1;
+    if (i < nLast) {
+      vMinX[i] = vMinX[nLast];
+      vMinY[i] = vMinY[nLast];
+      vMaxX[i] = vMaxX[nLast];
+      vMaxY[i] = vMaxY[nLast];
+      vItem[i] = std::move(vItem[nLast]);
+      vHandle[i] = vHandle[nLast];
+    }
+    std::destroy_at(&vItem[nLast]);
+    nSize--;
+  }
+
+  // Appends all of other's items, leaving other empty
+  void append(NodeItems &other) {
+    reserve(size() + other.size());
+    for (size_t i = 0; i < other.size(); i++)
+      push_back(other.vMinX[i], other.vMinY[i], other.vMaxX[i], other.vMaxY[i], std::move(other.vItem[i]),
+                other.vHandle[i]);
+    other.clear();
+  }
+
+  // Calls fn(i) for every item i overlapping rArea
+  template<typename Fn>
+  void search_index(const olc::rect &rArea, Fn &&fn) const {
+    const float qMinX = rArea.pos.x, qMinY = rArea.pos.y;
+    const float qMaxX = rArea.pos.x + rArea.size.x, qMaxY = rArea.pos.y + rArea.size.y;
+
+    size_t i = 0;
+    for (; i + OVERLAP_LANES <= size(); i += OVERLAP_LANES) {
+      uint32_t nMask = overlap_mask(&vMinX[i], &vMinY[i], &vMaxX[i], &vMaxY[i], qMinX, qMinY, qMaxX, qMaxY);
+      for (; nMask != 0; nMask &= nMask - 1) fn(i + std::countr_zero(nMask));
+    }
+    for (; i < size(); i++) {
+      if (qMinX < vMaxX[i] && qMaxX >= vMinX[i] && qMinY < vMaxY[i] && qMaxY >= vMinY[i]) fn(i);
+    }
+  }
+
+  // Calls fn(item) for every item overlapping rArea
+  template<typename Fn>
+  void search(const olc::rect &rArea, Fn &&fn) const {
+    search_index(rArea, [&](size_t i) { fn(vItem[i]); });
+  }
+
+  // Index of the first item overlapping rArea, or size() if none does
+  size_t find_first(const olc::rect &rArea) const {
+    const float qMinX = rArea.pos.x, qMinY = rArea.pos.y;
+    const float qMaxX = rArea.pos.x + rArea.size.x, qMaxY = rArea.pos.y + rArea.size.y;
+
+    size_t i = 0;
+    for (; i + OVERLAP_LANES <= size(); i += OVERLAP_LANES) {
+      uint32_t nMask = overlap_mask(&vMinX[i], &vMinY[i], &vMaxX[i], &vMaxY[i], qMinX, qMinY, qMaxX, qMaxY);
+      if (nMask != 0) return i + std::countr_zero(nMask);
+    }
+    for (; i < size(); i++) {
+      if (qMinX < vMaxX[i] && qMaxX >= vMinX[i] && qMinY < vMaxY[i] && qMaxY >= vMinY[i]) return i;
+    }
+    return size();
+  }
+
+  // Number of items overlapping rArea
+  size_t count(const olc::rect &rArea) const {
+    const float qMinX = rArea.pos.x, qMinY = rArea.pos.y;
+    const float qMaxX = rArea.pos.x + rArea.size.x, qMaxY = rArea.pos.y + rArea.size.y;
+
+    size_t nCount = 0, i = 0;
+    for (; i + OVERLAP_LANES <= size(); i += OVERLAP_LANES)
+      nCount += std::popcount(overlap_mask(&vMinX[i], &vMinY[i], &vMaxX[i], &vMaxY[i], qMinX, qMinY, qMaxX, qMaxY));
+    for (; i < size(); i++) {
+      if (qMinX < vMaxX[i] && qMaxX >= vMinX[i] && qMinY < vMaxY[i] && qMaxY >= vMinY[i]) nCount++;
+    }
+    return nCount;
+  }
+
+ private:
+  static constexpr std::align_val_t ALIGNMENT{std::max(alignof(Type), size_t(32))};
+
+  // Points the arrays into a fresh buffer of n slots, with the four float arrays and the
+  // handles first and the items after them at Type's alignment
+  void allocate(size_t n) {
+    const size_t nItemOffset = (n * (4 * sizeof(float) + sizeof(uint32_t)) + alignof(Type) - 1) / alignof(Type)
+        * alignof(Type);
+    std::byte *pBuffer = static_cast<std::byte *>(::operator new(nItemOffset + n * sizeof(Type), ALIGNMENT));
+    vMinX = reinterpret_cast<float *>(pBuffer);
+    vMinY = vMinX + n;
+    vMaxX = vMinY + n;
+    vMaxY = vMaxX + n;
+    vHandle = reinterpret_cast<uint32_t *>(vMaxY + n);
+    vItem = reinterpret_cast<Type *>(pBuffer + nItemOffset);
+    nCapacity = uint32_t(n);
+  }
+};
+
+// An item's bounds and a pointer to it, carried down a StaticQuadTree by the pair joins to be
+// tested against the items there. The item may come from a tree of another type.
+template<typename Type>
+struct ItemProbe {
+  float fMinX, fMinY, fMaxX, fMaxY;
+  const Type *pItem;
+
+  bool touches(const olc::rect &r) const {
+    return fMinX <= r.pos.x + r.size.x && r.pos.x <= fMaxX && fMinY <= r.pos.y + r.size.y && r.pos.y <= fMaxY;
+  }
+};
+
+constexpr size_t MAX_DEPTH = 8;
+
+// Per-subtree summary a StaticQuadTree keeps in every node alongside the item count, reported
+// by lod_search() for subtrees too small to be worth visiting. An aggregate provides
+// add(item), remove(item) and add(other) to merge a child's summary, and every node starts
+// out as a copy of the empty aggregate given to the tree. This one keeps nothing.
+struct NoAggregate {
+  template<typename T> void add(const T &) {}
+  template<typename T> void remove(const T &) {}
+};
+
+// How a StaticQuadTree subdivides, can be changed at runtime with set_config()
+struct QuadTreeConfig {
+  size_t nMaxDepth = MAX_DEPTH; // nodes at depth nMaxDepth - 1 are never split
+  size_t nLeafCapacity = 0; // a leaf splits once it holds more items than this and a split node
+                            // merges back once its subtree holds fewer, 0 pushes items as deep as they fit
+  float fMinNodeSize = 0.0f; // a node is not split if its children would be narrower than this
+  float fLooseness = 1.0f; // above 1 each child's bounds are grown by this factor (a loose quadtree), so
+                           // items that straddle a child boundary can still sink below it
+};
+
+// The cells a StaticQuadTree::lod_search() pools small items into: a grid of square cells over
+// the search area, each holding how many items were pooled into it and their merged aggregate.
+// The caller keeps one between searches, so the table is only grown when a search needs more
+// cells than any before it, and only the cells filled last time are cleared. Cells are stored
+// in 8 x 8 tiles rather than row by row, so the cells one quadtree node pools into sit close
+// together in memory.
+template<typename Aggregate>
+class LodGrid {
+ public:
+  // Empties the grid and lays it out as cells fCellSize wide from the corner of rArea, enough
+  // to cover it, so the table grows with the area divided by fCellSize squared. A size that is
+  // not positive leaves no cells.
+  void reset(const olc::rect &rArea, float fCellSize, const Aggregate &emptyAggregate) {
+    for (uint32_t c : m_vUsed) m_vCells[c].nCount = 0;
+    m_vUsed.clear();
+    m_rArea = rArea;
+    m_fCellSize = fCellSize;
+    m_emptyAggregate = emptyAggregate;
+    m_nWidth = m_nHeight = 0;
+    if (!(fCellSize > 0.0f)) return;
+
+    m_fInvCellSize = 1.0f / fCellSize;
+    m_nWidth = std::max(1u, uint32_t(std::ceil(rArea.size.x * m_fInvCellSize)));
+    m_nHeight = std::max(1u, uint32_t(std::ceil(rArea.size.y * m_fInvCellSize)));
+    m_nTilesX = (m_nWidth + TILE - 1) / TILE;
+    const size_t nCells = size_t(m_nTilesX) * ((m_nHeight + TILE - 1) / TILE) * TILE * TILE;
+    if (m_vCells.size() < nCells) m_vCells.resize(nCells, {emptyAggregate, 0});
+  }
+
+  uint32_t width() const { return m_nWidth; }
+  uint32_t height() const { return m_nHeight; }
+
+  // Number of cells holding anything
+  size_t size() const { return m_vUsed.size(); }
+
+  // The area covered by cell (x, y)
+  olc::rect cell(uint32_t x, uint32_t y) const {
+    return {m_rArea.pos + olc::vf2d(float(x), float(y)) * m_fCellSize, {m_fCellSize, m_fCellSize}};
+  }
+
+  // Calls fn(x, y, count, aggregate) for every cell holding anything, in the order they were
+  // first filled
+  template<typename Fn>
+  void for_each(Fn &&fn) const {
+    for (uint32_t c : m_vUsed) {
+      const uint32_t nTile = c / (TILE * TILE), nInTile = c % (TILE * TILE);
+      fn(nTile % m_nTilesX * TILE + nInTile % TILE, nTile / m_nTilesX * TILE + nInTile / TILE,
+         size_t(m_vCells[c].nCount), m_vCells[c].aggregate);
+    }
+  }
+
+  // Pools one item into the cell holding the point (x, y), or the nearest cell if outside
+  template<typename Item>
+  void add_item(float x, float y, const Item &item) {
+    fill(x, y, 1).add(item);
+  }
+
+  // Pools a whole subtree of nCount items into the cell holding the point (x, y)
+  void add_subtree(float x, float y, size_t nCount, const Aggregate &aggregate) {
+    fill(x, y, nCount).add(aggregate);
+  }
+
+ private:
+  static constexpr uint32_t TILE = 8;
+
+  struct Cell {
+    Aggregate aggregate; // only meaningful while nCount is not 0
+    uint32_t nCount;
+  };
+
+  Aggregate &fill(float x, float y, size_t nCount) {
+    auto index = [&](float f, float fOrigin, uint32_t nCells) {
+      return uint32_t(std::clamp((f - fOrigin) * m_fInvCellSize, 0.0f, float(nCells - 1)));
+    };
+    const uint32_t cx = index(x, m_rArea.pos.x, m_nWidth), cy = index(y, m_rArea.pos.y, m_nHeight);
+    const uint32_t c = ((cy / TILE) * m_nTilesX + cx / TILE) * TILE * TILE + (cy % TILE) * TILE + cx % TILE;
+    Cell &cell = m_vCells[c];
+    if (cell.nCount == 0) {
+      m_vUsed.push_back(c);
+      cell.aggregate = m_emptyAggregate;
+    }
+    cell.nCount += uint32_t(nCount);
+    return cell.aggregate;
+  }
+
+  olc::rect m_rArea;
+  float m_fCellSize = 0.0f, m_fInvCellSize = 0.0f;
+  uint32_t m_nWidth = 0, m_nHeight = 0, m_nTilesX = 0;
+  Aggregate m_emptyAggregate;
+  std::vector<Cell> m_vCells; // tile by tile, each tile row by row
+  std::vector<uint32_t> m_vUsed; // cells whose count is not 0
+};
+
+// Threads kept alive for the parallel build and searches, so a call hands them work instead of
+// starting threads of its own. run() splits a job into tasks that the pool's threads and the
+// calling thread take in turn, and a task may itself call run(): its caller works through the
+// inner tasks too, so nothing waits on a task that no thread has taken.
+class TaskPool {
+ public:
+  explicit TaskPool(size_t nWorkers) {
+    for (size_t w = 0; w < nWorkers; w++) m_workers.emplace_back([this]() { work(); });
+  }
+
+  ~TaskPool() {
+    {
+      std::lock_guard lock(m_mutex);
+      m_bStop = true;
+    }
+    m_cvWork.notify_all();
+    for (auto &worker : m_workers) worker.join();
+  }
+
+  TaskPool(const TaskPool &) = delete;
+  TaskPool &operator=(const TaskPool &) = delete;
+
+  // The pool shared by every tree, one thread per core counting the caller's
+  static TaskPool &shared() {
+    static TaskPool pool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+    return pool;
+  }
+
+  // Threads that can work on one run(), counting the caller's
+  size_t threads() const { return m_workers.size() + 1; }
+
+  // Calls fn(i) for every i below nTasks and returns once all have finished, rethrowing the
+  // first exception a task threw
+  template<typename Fn>
+  void run(size_t nTasks, Fn &&fn) {
+    if (nTasks == 0) return;
+    Batch batch;
+    batch.nTasks = nTasks;
+    batch.pFn = &fn;
+    batch.fnCall = [](void *pFn, size_t i) { (*static_cast<std::remove_reference_t<Fn> *>(pFn))(i); };
+
+    std::unique_lock lock(m_mutex);
+    if (nTasks > 1 && !m_workers.empty()) {
+      m_batches.push_back(&batch);
+      m_cvWork.notify_all();
+    }
+    while (run_next(batch, lock)) {}
+    m_cvDone.wait(lock, [&]() { return batch.nDone == batch.nTasks; });
+    if (batch.pException) std::rethrow_exception(batch.pException);
+  }
+
+ private:
+  struct Batch {
+    size_t nTasks = 0, nNext = 0, nDone = 0;
+    void *pFn = nullptr;
+    void (*fnCall)(void *, size_t) = nullptr;
+    std::exception_ptr pException;
+  };
+
+  // Runs the next untaken task of batch with the lock released, false if there is none. A
+  // batch leaves the queue once its last task is taken.
+  bool run_next(Batch &batch, std::unique_lock<std::mutex> &lock) {
+    if (batch.nNext == batch.nTasks) return false;
+    const size_t i = batch.nNext++;
+    if (batch.nNext == batch.nTasks) {
+      auto it = std::find(m_batches.begin(), m_batches.end(), &batch);
+      if (it != m_batches.end()) m_batches.erase(it);
+    }
+    lock.unlock();
+    std::exception_ptr pException;
+    try {
+      batch.fnCall(batch.pFn, i);
+    } catch (...) {
+      pException = std::current_exception();
+    }
+    lock.lock();
+    if (pException && !batch.pException) batch.pException = pException;
+    if (++batch.nDone == batch.nTasks) m_cvDone.notify_all();
+    return true;
+  }
+
+  void work() {
+    std::unique_lock lock(m_mutex);
+    while (true) {
+      m_cvWork.wait(lock, [this]() { return m_bStop || !m_batches.empty(); });
+      if (m_bStop) return;
+      run_next(*m_batches.front(), lock);
+    }
+  }
+
+  std::vector<std::thread> m_workers;
+  std::vector<Batch *> m_batches; // batches with tasks still to be taken, oldest first
+  std::mutex m_mutex;
+  std::condition_variable m_cvWork, m_cvDone;
+  bool m_bStop = false;
+};
+
+template<typename Type, typename Aggregate = NoAggregate>
+class StaticQuadTree {
+ public:
+  // Nodes refer to each other by 32-bit index into the node arena
+  static constexpr uint32_t NONE = std::numeric_limits<uint32_t>::max();
+
+  // Subtrees with fewer items than this are not worth a thread of their own during build()
+  static constexpr size_t PARALLEL_BUILD_MIN_ITEMS = 1 << 16;
+
+  // Fewer queries than this are not worth a thread of their own during search_batch()
+  static constexpr size_t PARALLEL_BATCH_MIN_QUERIES = 256;
+
+  // Trees with fewer items than this are searched on one thread by search_parallel()
+  static constexpr size_t PARALLEL_SEARCH_MIN_ITEMS = 1 << 14;
+
+  // Identifies an inserted item for remove() and relocate(), stays valid however the tree
+  // restructures until the item is removed
+  using Handle = uint32_t;
+
+  StaticQuadTree( size_t nDepth = 0, const olc::rect &rArea = {{0.0f, 0.0f}, {100000.0f, 100000.0f}},
+                  const QuadTreeConfig &config = {}, const Aggregate &emptyAggregate = {}) {
+    m_depth = nDepth;
+    m_config = config;
+    m_emptyAggregate = emptyAggregate;
+    resize(rArea);
+
+  }
+  void resize(const olc::rect &rArea) {
+    m_rect = rArea;
+    clear();
+  }
+
+  // Drops every node but the root, keeping the arena's capacity for the next build
+  void clear() {
+    m_nodes.clear();
+    m_freeNodes.clear();
+    m_locations.clear();
+    m_freeHandles.clear();
+    m_nodes.push_back(make_node(m_depth, m_rect));
+  }
+
+  const QuadTreeConfig &config() const { return m_config; }
+
+  // Changes the subdivision policy, splitting and merging nodes until the tree follows it
+  void set_config(const QuadTreeConfig &config) {
+    const bool bRegrid = config.fLooseness != m_config.fLooseness;
+    m_config = config;
+    if (bRegrid) {
+      // Every child's bounds change, so start again from a single leaf
+      collapse(0);
+      m_nodes[0].rChild = child_bounds(m_nodes[0].rect);
+    }
+    rebalance(0);
+  }
+
+  size_t size() const {
+    return m_nodes[0].nCount;
+  }
+
+  // Number of objects in the given search area. Children entirely inside it contribute their
+  // cached subtree count, so only nodes straddling its edge are walked.
+  [[nodiscard]] size_t count(const olc::rect &rArea) const {
+    return count(0, rArea);
+  }
+
+  // Level-of-detail search. The search area is divided into square cells fMinNodeSize wide,
+  // laid out in cells, which the caller keeps between searches. Items in the area narrower
+  // than a cell in both directions are not passed to fnItem(item) but added to the cell
+  // holding their centre as they are visited, as are whole subtrees whose node is that small,
+  // which are not walked. Larger items go to fnItem as in search(). Afterwards cells holds the
+  // count and aggregate of every cell that pooled anything, see LodGrid::for_each().
+  template<typename FnItem> requires std::invocable<FnItem &, const Type &>
+  void lod_search(const olc::rect &rArea, float fMinNodeSize, LodGrid<Aggregate> &cells, FnItem &&fnItem) const {
+    cells.reset(rArea, fMinNodeSize, m_emptyAggregate);
+    if (!(fMinNodeSize > 0.0f)) {
+      search(0, rArea, fnItem);
+      return;
+    }
+    lod_search(0, rArea, fMinNodeSize, cells, fnItem);
+  }
+
+  // Calls fn(item) for every item containing p, by the same test as olc::rect::containsPoint.
+  // Only children whose bounds contain p are descended, a single path unless the tree is loose.
+  template<typename Fn> requires std::invocable<Fn &, const Type &>
+  void query_point(const olc::vf2d &p, Fn &&fn) const {
+    // An empty rect at p overlaps exactly the items containing p
+    query_point(0, olc::rect(p, {0.0f, 0.0f}), fn);
+  }
+
+  // First item found containing p, or nullptr, for picking. The walk stops at that item.
+  // The pointer is valid until the tree next changes.
+  [[nodiscard]] const Type *query_point(const olc::vf2d &p) const {
+    return query_point(0, olc::rect(p, {0.0f, 0.0f}));
+  }
+
+  // Calls fn(item) for every item whose area comes within fRadius of vCenter, by exact
+  // circle-box distance. Children entirely outside the circle are skipped and children
+  // entirely inside it are reported without testing their items.
+  template<typename Fn> requires std::invocable<Fn &, const Type &>
+  void search_circle(const olc::vf2d &vCenter, float fRadius, Fn &&fn) const {
+    search_circle(0, vCenter, fRadius * fRadius, fn);
+  }
+
+  // Appends the items within rArea to vItems like search(), but spread over nThreads threads
+  // of TaskPool::shared() (by default all of them), which pays off for areas covering much of a large tree. The top
+  // levels are split into a few subtrees per thread, and each thread keeps taking the next
+  // untaken subtree, largest first, into its own buffer until none are left. The buffers are
+  // concatenated at the end, so items come in a different order to search(). The tree must not
+  // change meanwhile.
+  void search_parallel(const olc::rect &rArea, std::vector<Type> &vItems, size_t nThreads = 0) const {
+    TaskPool &pool = TaskPool::shared();
+    if (nThreads == 0) nThreads = pool.threads();
+    auto push = [&](const Type &item) { vItems.push_back(item); };
+    if (nThreads == 1 || size() < PARALLEL_SEARCH_MIN_ITEMS) {
+      search(0, rArea, push);
+      return;
+    }
+
+    // Subtrees as (node, entirely inside rArea). Items held above them are searched here while
+    // splitting.
+    std::vector<std::pair<uint32_t, bool>> vTasks = {{0, false}}, vNext;
+    while (vTasks.size() < 4 * nThreads) {
+      vNext.clear();
+      for (auto [n, bContained] : vTasks) {
+        const Node &node = m_nodes[n];
+        if (bContained) {
+          vItems.insert(vItems.end(), node.items.vItem, node.items.vItem + node.items.size());
+        } else {
+          node.items.search(rArea, push);
+        }
+        for (int i = 0; i < 4; i++) {
+          if (node.nChild[i] == NONE) continue;
+          if (bContained || rArea.containsRect(node.rChild[i])) {
+            vNext.push_back({node.nChild[i], true});
+          } else if (rArea.overlaps(node.rChild[i])) {
+            vNext.push_back({node.nChild[i], false});
+          }
+        }
+      }
+      vTasks.swap(vNext);
+      if (vTasks.empty()) return;
+    }
+    std::sort(vTasks.begin(), vTasks.end(), [&](auto const &a, auto const &b) {
+      return m_nodes[a.first].nCount > m_nodes[b.first].nCount;
+    });
+
+    std::vector<std::vector<Type>> vBuffers(nThreads);
+    std::atomic<size_t> nNextTask = 0;
+    auto worker = [&](size_t w) {
+      auto push_own = [&](const Type &item) { vBuffers[w].push_back(item); };
+      for (size_t t = nNextTask++; t < vTasks.size(); t = nNextTask++) {
+        const auto [n, bContained] = vTasks[t];
+        if (bContained) {
+          items(n, push_own);
+        } else {
+          search(n, rArea, push_own);
+        }
+      }
+    };
+    pool.run(nThreads, worker);
+
+    size_t nTotal = vItems.size();
+    for (auto const &vBuffer : vBuffers) nTotal += vBuffer.size();
+    vItems.reserve(nTotal);
+    for (auto const &vBuffer : vBuffers) vItems.insert(vItems.end(), vBuffer.begin(), vBuffer.end());
+  }
+
+  // Results of search_batch() in one flat buffer, the hits of query i being
+  // vHits[vOffsets[i]] up to but not including vHits[vOffsets[i + 1]]
+  struct BatchResult {
+    std::vector<size_t> vOffsets;
+    std::vector<Type> vHits;
+  };
+
+  // Runs many searches at once, replacing the contents of result. Queries are taken in the
+  // Morton order of their centres, so consecutive searches mostly walk the same nodes, and that
+  // order is split into one run per thread of TaskPool::shared() (by default all of them). Each
+  // run collects its hits privately before they are copied into place. The tree must not
+  // change meanwhile.
+  void search_batch(std::span<const olc::rect> vQueries, BatchResult &result, size_t nThreads = 0) const {
+    const size_t nQueries = vQueries.size();
+    result.vOffsets.assign(nQueries + 1, 0);
+    result.vHits.clear();
+    if (nQueries == 0) return;
+
+    // Sort by centre cell on a 65536 x 65536 grid over the tree's area
+    std::vector<std::pair<uint32_t, uint32_t>> vOrder(nQueries);
+    for (size_t i = 0; i < nQueries; i++) {
+      const olc::vf2d vCentre = (vQueries[i].pos + vQueries[i].size * 0.5f - m_rect.pos) / m_rect.size;
+      auto cell = [](float f) { return uint32_t(std::clamp(f * 65535.0f, 0.0f, 65535.0f)); };
+      vOrder[i] = {morton(cell(vCentre.x), cell(vCentre.y)), uint32_t(i)};
+    }
+    std::sort(vOrder.begin(), vOrder.end());
+
+    TaskPool &pool = TaskPool::shared();
+    if (nThreads == 0) nThreads = pool.threads();
+    const size_t nRuns = std::clamp(nQueries / PARALLEL_BATCH_MIN_QUERIES, size_t(1), nThreads);
+
+    // Each run's hits, and how many of them each of its queries produced
+    struct Run {
+      std::vector<Type> vHits;
+      std::vector<size_t> vCount;
+    };
+    std::vector<Run> vRuns(nRuns);
+    auto run_range = [&](size_t r) { return std::pair(nQueries * r / nRuns, nQueries * (r + 1) / nRuns); };
+
+    pool.run(nRuns, [&](size_t r) {
+      auto [nBegin, nEnd] = run_range(r);
+      Run &run = vRuns[r];
+      run.vCount.reserve(nEnd - nBegin);
+      for (size_t j = nBegin; j < nEnd; j++) {
+        const size_t nBefore = run.vHits.size();
+        search(vQueries[vOrder[j].second], [&](const Type &item) { run.vHits.push_back(item); });
+        run.vCount.push_back(run.vHits.size() - nBefore);
+      }
+    });
+
+    for (size_t r = 0; r < nRuns; r++) {
+      const size_t nBegin = run_range(r).first;
+      for (size_t j = 0; j < vRuns[r].vCount.size(); j++)
+        result.vOffsets[vOrder[nBegin + j].second + 1] = vRuns[r].vCount[j];
+    }
+    std::partial_sum(result.vOffsets.begin(), result.vOffsets.end(), result.vOffsets.begin());
+    result.vHits.resize(result.vOffsets.back());
+
+    pool.run(nRuns, [&](size_t r) {
+      const size_t nBegin = run_range(r).first;
+      auto itHit = vRuns[r].vHits.begin();
+      for (size_t j = 0; j < vRuns[r].vCount.size(); j++) {
+        std::copy_n(itHit, vRuns[r].vCount[j], result.vHits.begin() + result.vOffsets[vOrder[nBegin + j].second]);
+        itHit += vRuns[r].vCount[j];
+      }
+    });
+  }
+
+  // Calls fn(a, b) once for every pair of items whose areas overlap or touch, as a collision
+  // broad phase. A single walk tests each node's items against each other and against the
+  // items passed down from its ancestors, which are only passed into children they reach. In a
+  // loose tree, sibling subtrees whose bounds overlap are also joined against each other.
+  template<typename Fn> requires std::invocable<Fn &, const Type &, const Type &>
+  void for_each_overlapping_pair(Fn &&fn) const {
+    std::vector<Probe<Type>> vProbes;
+    overlapping_pairs(0, vProbes, 0, fn);
+  }
+
+  // Calls fn(mine, theirs) for every pair of an item in this tree and an item in other whose
+  // areas overlap or touch. Both trees are walked together and a pair of nodes is only visited
+  // if their bounds overlap, so the trees may cover different areas to different depths.
+  template<typename Other, typename OtherAggregate, typename Fn>
+  requires std::invocable<Fn &, const Type &, const Other &>
+  void join(const StaticQuadTree<Other, OtherAggregate> &other, Fn &&fn) const {
+    std::vector<Probe<Type>> vMine;
+    std::vector<Probe<Other>> vTheirs;
+    join(0, other, 0, nullptr, vMine, vTheirs, fn);
+  }
+
+  // Calls fn(item) for every item overlapping the convex polygon with the given vertices, in
+  // either winding, such as a rotated rect or camera frustum. Nodes and items are tested with
+  // separating axes, the x and y axes and each edge's normal, rather than the polygon's
+  // bounding box. Children entirely inside the polygon are reported without testing their items.
+  template<typename Fn> requires std::invocable<Fn &, const Type &>
+  void search_polygon(std::span<const olc::vf2d> vPolygon, Fn &&fn) const {
+    if (vPolygon.empty()) return;
+    search_polygon(0, PolygonAxes(vPolygon), fn);
+  }
+
+  // Calls fn(item, t) for every item the segment vOrigin + t * vDir, 0 <= t <= fMaxT, passes
+  // through, t being where it enters the item (0 if it starts inside). Only nodes the segment
+  // crosses are walked, nearest first, so hits come roughly but not strictly in order of t.
+  template<typename Fn> requires std::invocable<Fn &, const Type &, float>
+  void raycast(const olc::vf2d &vOrigin, const olc::vf2d &vDir, float fMaxT, Fn &&fn) const {
+    ray_walk(vOrigin, vDir, fMaxT, [&](const Type &item, float t) {
+      fn(item, t);
+      return std::numeric_limits<float>::infinity();
+    });
+  }
+
+  // The first item along the segment vOrigin + t * vDir, 0 <= t <= fMaxT, with the t it is
+  // entered at, or nothing if the segment hits no item. The walk stops once the next node is
+  // entered no earlier than the closest hit so far.
+  [[nodiscard]] std::optional<std::pair<Type, float>> raycast(const olc::vf2d &vOrigin, const olc::vf2d &vDir,
+                                                              float fMaxT) const {
+    std::optional<std::pair<Type, float>> hit;
+    ray_walk(vOrigin, vDir, fMaxT, [&](const Type &item, float t) {
+      hit.emplace(item, t);
+      return t;
+    });
+    return hit;
+  }
+
+  // The k items whose areas are closest to p, nearest first, any item containing p being at
+  // distance 0. Nodes are visited best first by the distance from p to their bounds, and the
+  // walk stops once the next node is no closer than the k-th best item found so far.
+  [[nodiscard]] std::vector<Type> nearest(const olc::vf2d &p, size_t k) const {
+    std::vector<Type> vNearest;
+    if (k == 0) return vNearest;
+
+    // Best items so far as (squared distance, location), a max heap so the k-th best is on top
+    std::vector<std::pair<float, Location>> vBest;
+    vBest.reserve(k + 1);
+    // Nodes still to visit as (squared distance, node), nearest on top. The root can hold items
+    // outside the tree's area, so it is always visited.
+    std::priority_queue<std::pair<float, uint32_t>, std::vector<std::pair<float, uint32_t>>, std::greater<>> queue;
+    queue.push({0.0f, 0});
+
+    while (!queue.empty()) {
+      const auto [fNodeDist, n] = queue.top();
+      if (vBest.size() == k && fNodeDist >= vBest.front().first) break;
+      queue.pop();
+
+      const Node &node = m_nodes[n];
+      const NodeItems<Type> &vItems = node.items;
+      for (size_t i = 0; i < vItems.size(); i++) {
+        const float fDist = distance2(p, vItems.vMinX[i], vItems.vMinY[i], vItems.vMaxX[i], vItems.vMaxY[i]);
+        if (vBest.size() == k) {
+          if (fDist >= vBest.front().first) continue;
+          std::pop_heap(vBest.begin(), vBest.end(), less_distance);
+          vBest.pop_back();
+        }
+        vBest.push_back({fDist, {n, uint32_t(i)}});
+        std::push_heap(vBest.begin(), vBest.end(), less_distance);
+      }
+
+      for (int i = 0; i < 4; i++) {
+        if (node.nChild[i] == NONE || m_nodes[node.nChild[i]].nCount == 0) continue;
+        const olc::rect &r = node.rChild[i];
+        const float fDist = distance2(p, r.pos.x, r.pos.y, r.pos.x + r.size.x, r.pos.y + r.size.y);
+        if (vBest.size() < k || fDist < vBest.front().first) queue.push({fDist, node.nChild[i]});
+      }
+    }
+
+    std::sort_heap(vBest.begin(), vBest.end(), less_distance);
+    vNearest.reserve(vBest.size());
+    for (auto const &[fDist, loc] : vBest) vNearest.push_back(m_nodes[loc.nNode].items.vItem[loc.nSlot]);
+    return vNearest;
+  }
+
+  // Pre-sizes the arena so a build of roughly nNodes nodes does not reallocate
+  void reserve(size_t nNodes) {
+    m_nodes.reserve(nNodes);
+  }
+
+ public:
+
+  Handle insert(const Type &item, const olc::rect &item_size) {
+    Handle h;
+    if (!m_freeHandles.empty()) {
+      h = m_freeHandles.back();
+      m_freeHandles.pop_back();
+    } else {
+      h = Handle(m_locations.size());
+      m_locations.push_back({NONE, 0});
+    }
+    insert(0, h, item, item_size.pos.x, item_size.pos.y, item_size.pos.x + item_size.size.x,
+           item_size.pos.y + item_size.size.y);
+    return h;
+  }
+
+  // Inserts under a handle the caller picked, which must not be in use, so the caller can name
+  // items by its own ids. A caller that recycles ids last-freed-first, as SlotMap does, keeps
+  // this constant time.
+  void insert(const Type &item, const olc::rect &item_size, Handle h) {
+    if (h >= m_locations.size()) {
+      m_locations.resize(size_t(h) + 1, {NONE, 0});
+    } else if (auto it = std::find(m_freeHandles.rbegin(), m_freeHandles.rend(), h); it != m_freeHandles.rend()) {
+      m_freeHandles.erase(std::next(it).base());
+    }
+    insert(0, h, item, item_size.pos.x, item_size.pos.y, item_size.pos.x + item_size.size.x,
+           item_size.pos.y + item_size.size.y);
+  }
+
+  // The item a handle refers to
+  const Type &get(Handle h) const {
+    return m_nodes[m_locations[h].nNode].items.vItem[m_locations[h].nSlot];
+  }
+
+  // Removes an item in constant time apart from the walk up its ancestors' counts, merging
+  // any ancestor that drops below the leaf capacity
+  void remove(Handle h) {
+    uint32_t nFrom;
+    detach(h, NONE, nFrom);
+    m_locations[h] = {NONE, 0};
+    m_freeHandles.push_back(h);
+    merge_up(nFrom);
+  }
+
+  // Gives an item a new area. While its node can still hold it only the stored bounds change,
+  // otherwise it is reinserted from the nearest ancestor that can, keeping its handle.
+  void relocate(Handle h, const olc::rect &new_size) {
+    const float fMinX = new_size.pos.x, fMinY = new_size.pos.y;
+    const float fMaxX = new_size.pos.x + new_size.size.x, fMaxY = new_size.pos.y + new_size.size.y;
+    const Location loc = m_locations[h];
+
+    uint32_t a = loc.nNode;
+    while (!holds(a, fMinX, fMinY, fMaxX, fMaxY)) a = m_nodes[a].nParent;
+    if (a == loc.nNode) {
+      m_nodes[a].items.set_bounds(loc.nSlot, fMinX, fMinY, fMaxX, fMaxY);
+      return;
+    }
+
+    uint32_t nFrom;
+    Type item = detach(h, a, nFrom);
+    insert(a, h, item, fMinX, fMinY, fMaxX, fMaxY);
+    merge_up(nFrom);
+  }
+
+  // Applies a frame's worth of (handle, new area) moves in one pass. Items that still fit
+  // their node are updated in place. The rest are all taken out first, then reinserted from
+  // the nearest ancestor that holds them, grouped by that ancestor, and only once everything
+  // has moved are nodes left under capacity merged.
+  void update_all(std::span<const std::pair<Handle, olc::rect>> vMoves) {
+    struct Pending {
+      uint32_t nFrom; // ancestor the item is reinserted from
+      Handle h;
+      Type item;
+      float fMinX, fMinY, fMaxX, fMaxY;
+    };
+    std::vector<Pending> vPending;
+    std::vector<uint32_t> vVacated;
+
+    for (auto const &[h, new_size] : vMoves) {
+      const float fMinX = new_size.pos.x, fMinY = new_size.pos.y;
+      const float fMaxX = new_size.pos.x + new_size.size.x, fMaxY = new_size.pos.y + new_size.size.y;
+      const Location loc = m_locations[h];
+
+      if (loc.nNode == NONE) {
+        // Already taken out earlier in this batch, nSlot is its pending entry. The last move
+        // wins, and if its ancestor cannot hold the new area the item is uncounted further up.
+        Pending &p = vPending[loc.nSlot];
+        while (!holds(p.nFrom, fMinX, fMinY, fMaxX, fMaxY)) {
+          p.nFrom = m_nodes[p.nFrom].nParent;
+          m_nodes[p.nFrom].nCount--;
+          m_nodes[p.nFrom].aggregate.remove(p.item);
+        }
+        p.fMinX = fMinX;
+        p.fMinY = fMinY;
+        p.fMaxX = fMaxX;
+        p.fMaxY = fMaxY;
+        continue;
+      }
+
+      uint32_t a = loc.nNode;
+      while (!holds(a, fMinX, fMinY, fMaxX, fMaxY)) a = m_nodes[a].nParent;
+      if (a == loc.nNode) {
+        m_nodes[a].items.set_bounds(loc.nSlot, fMinX, fMinY, fMaxX, fMaxY);
+        continue;
+      }
+
+      uint32_t nFrom;
+      Type item = detach(h, a, nFrom);
+      vPending.push_back({a, h, std::move(item), fMinX, fMinY, fMaxX, fMaxY});
+      vVacated.push_back(nFrom);
+      m_locations[h] = {NONE, uint32_t(vPending.size() - 1)};
+    }
+
+    std::sort(vPending.begin(), vPending.end(), [](const Pending &l, const Pending &r) { return l.nFrom < r.nFrom; });
+    for (auto &p : vPending) insert(p.nFrom, p.h, p.item, p.fMinX, p.fMinY, p.fMaxX, p.fMaxY);
+
+    std::sort(vVacated.begin(), vVacated.end());
+    vVacated.erase(std::unique(vVacated.begin(), vVacated.end()), vVacated.end());
+    for (uint32_t n : vVacated) merge_up(n);
+  }
+
+  // Replaces the contents of the tree with the given (item, area) pairs. Nodes are split by
+  // the same policy as insert(), but the tree is built in one top-down partitioning pass and
+  // every node's item storage is allocated once at its final size. Large inputs build the
+  // top quadrants' subtrees in parallel on TaskPool::shared().
+  void build(std::span<const std::pair<Type, olc::rect>> vItems) {
+    clear();
+    if (vItems.empty()) return;
+
+    // The node arena is left to grow as nodes are made. Any bound worked out up front from the
+    // depth is far above what a tree with a leaf capacity actually uses.
+
+    std::vector<uint32_t> vIndex(vItems.size()), vScratch(vItems.size());
+    std::vector<int8_t> vQuad(vItems.size());
+    std::iota(vIndex.begin(), vIndex.end(), 0);
+
+    // Enough levels of one-thread-per-quadrant to give every core a few subtrees to work on
+    int nParallelLevels = 0;
+    while ((size_t(1) << (2 * nParallelLevels)) < 2 * TaskPool::shared().threads())
+      nParallelLevels++;
+    build(m_nodes, 0, vItems, vIndex.data(), vScratch.data(), vQuad.data(), vItems.size(), nParallelLevels);
+
+    // Handles are the input indices. Nodes only reach their final arena index once the
+    // parallel subtrees are spliced in, so locations are filled in afterwards.
+    m_locations.resize(vItems.size());
+    for (uint32_t n = 0; n < m_nodes.size(); n++) locate(n, 0);
+  }
+
+  [[nodiscard]] std::list<Type> search(const olc::rect &search_area) const {
+    std::list<Type> itemsInside;
+    search(search_area, itemsInside);
+    return itemsInside;
+  }
+// Returns the objects in the given search area, by adding to supplied list
+  void search(const olc::rect &rArea, std::list<Type> &listItems) const {
+    search(rArea, [&](const Type &item) { listItems.push_back(item); });
+  }
+
+  // Appends the objects in the given search area to vItems. Keeping the vector between calls
+  // reuses its capacity, so once it has grown a search allocates nothing.
+  void search(const olc::rect &rArea, std::vector<Type> &vItems) const {
+    search(rArea, [&](const Type &item) { vItems.push_back(item); });
+  }
+
+  // Calls fn(item) for each object in the given search area as the tree is walked, nothing is
+  // collected or allocated
+  template<typename Fn> requires std::invocable<Fn &, const Type &>
+  void search(const olc::rect &rArea, Fn &&fn) const {
+    search(0, rArea, fn);
+  }
+
+  void items(std::list<Type> &listItem) const {
+    items([&](const Type &item) { listItem.push_back(item); });
+  }
+
+  template<typename Fn> requires std::invocable<Fn &, const Type &>
+  void items(Fn &&fn) const {
+    items(0, fn);
+  }
+
+  // Iterator over the objects in a search area that walks the tree only as far as it is
+  // advanced. Nodes still to visit are kept on an explicit stack inside the iterator, so
+  // breaking out of the loop early skips the rest of the traversal.
+  class SearchIterator {
+   public:
+    using value_type = Type;
+    using difference_type = std::ptrdiff_t;
+
+    SearchIterator() = default;
+
+    SearchIterator(const StaticQuadTree *pTree, const olc::rect &rArea) : m_pTree(pTree), m_rArea(rArea) {
+      m_fMaxX = rArea.pos.x + rArea.size.x;
+      m_fMaxY = rArea.pos.y + rArea.size.y;
+      m_nNode = 0;
+      advance();
+    }
+
+    const Type &operator*() const { return m_pTree->m_nodes[m_nNode].items.vItem[m_nSlot]; }
+    const Type *operator->() const { return &**this; }
+
+    SearchIterator &operator++() {
+      m_nSlot++;
+      advance();
+      return *this;
+    }
+
+    void operator++(int) { ++*this; }
+
+    bool operator==(std::default_sentinel_t) const { return m_nNode == NONE; }
+
+   private:
+    // Stops on the next hit at or after the current slot, moving on through the stack
+    void advance() {
+      for (;;) {
+        const Node &node = m_pTree->m_nodes[m_nNode];
+        const NodeItems<Type> &items = node.items;
+        for (; m_nSlot < items.size(); m_nSlot++) {
+          if (m_bAll || (m_rArea.pos.x < items.vMaxX[m_nSlot] && m_fMaxX >= items.vMinX[m_nSlot]
+              && m_rArea.pos.y < items.vMaxY[m_nSlot] && m_fMaxY >= items.vMinY[m_nSlot]))
+            return;
+        }
+
+        // Pushed in reverse so children come off the stack in the same order search() visits them
+        for (int i = 3; i >= 0; i--) {
+          if (node.nChild[i] == NONE) continue;
+          if (m_bAll || m_rArea.containsRect(node.rChild[i])) m_vStack.push_back({node.nChild[i], true});
+          else if (m_rArea.overlaps(node.rChild[i])) m_vStack.push_back({node.nChild[i], false});
+        }
+
+        if (m_vStack.empty()) {
+          m_nNode = NONE;
+          return;
+        }
+        m_nNode = m_vStack.back().first;
+        m_bAll = m_vStack.back().second;
+        m_nSlot = 0;
+        m_vStack.pop_back();
+      }
+    }
+
+    const StaticQuadTree *m_pTree = nullptr;
+    olc::rect m_rArea;
+    float m_fMaxX = 0.0f, m_fMaxY = 0.0f;
+    uint32_t m_nNode = NONE; // NONE once the search is exhausted
+    size_t m_nSlot = 0;
+    bool m_bAll = false; // current node lies entirely inside the search area
+    std::vector<std::pair<uint32_t, bool>> m_vStack; // nodes still to visit, and whether they lie entirely inside
+  };
+
+  // Lazy view of the objects in a search area, for use with range-for or std::views
+  class SearchRange : public std::ranges::view_interface<SearchRange> {
+   public:
+    SearchRange() = default;
+    SearchRange(const StaticQuadTree *pTree, const olc::rect &rArea) : m_pTree(pTree), m_rArea(rArea) {}
+
+    SearchIterator begin() const { return SearchIterator(m_pTree, m_rArea); }
+    std::default_sentinel_t end() const { return {}; }
+
+   private:
+    const StaticQuadTree *m_pTree = nullptr;
+    olc::rect m_rArea;
+  };
+
+  // Returns the objects in the given search area lazily, the tree is only walked as the
+  // range is iterated
+  [[nodiscard]] SearchRange search_range(const olc::rect &rArea) const {
+    return SearchRange(this, rArea);
+  }
+
+  const olc::rect &area() { return m_rect; }
+
+ protected:
+  struct Node {
+    uint32_t nParent = NONE;
+    size_t nDepth = 0;
+    size_t nCount = 0; // items in this node and all of its descendants
+    bool bSplit = false; // items that fit a child are stored in the child rather than here
+    olc::rect rect; // dimensions of the current quadTreeSection
+    std::array<olc::rect, 4> rChild{}; // bounds of everything stored in each child, loosened if configured
+    std::array<uint32_t, 4> nChild{NONE, NONE, NONE, NONE}; // arena index of each sub QuadTree
+    NodeItems<Type> items;
+    [[no_unique_address]] Aggregate aggregate; // summary of every item in this subtree
+  };
+
+  // Quadrant i of rArea: 0 top left, 1 top right, 2 bottom left, 3 bottom right
+  static olc::rect quadrant(const olc::rect &rArea, int i) {
+    olc::vf2d vChildSize = rArea.size / 2.0f;
+    return olc::rect({rArea.pos.x + ((i & 1) ? vChildSize.x : 0.0f),
+                      rArea.pos.y + ((i & 2) ? vChildSize.y : 0.0f)}, vChildSize);
+  }
+
+  // Bounds of the children of a node covering rArea, each quadrant grown about its centre by
+  // the looseness factor
+  std::array<olc::rect, 4> child_bounds(const olc::rect &rArea) const {
+    std::array<olc::rect, 4> rBounds;
+    for (int i = 0; i < 4; i++) rBounds[i] = loosen(quadrant(rArea, i));
+    return rBounds;
+  }
+
+  // rArea grown about its centre by the looseness factor, which bounds the items a node holds
+  olc::rect loosen(const olc::rect &rArea) const {
+    return olc::rect(rArea.pos - rArea.size * ((m_config.fLooseness - 1.0f) / 2.0f), rArea.size * m_config.fLooseness);
+  }
+
+  // Where an item currently lives: its node and its slot in that node's items
+  struct Location {
+    uint32_t nNode;
+    uint32_t nSlot;
+  };
+
+  Node make_node(size_t nDepth, const olc::rect &rArea, uint32_t nParent = NONE) const {
+    Node node;
+    node.nParent = nParent;
+    node.nDepth = nDepth;
+    node.rect = rArea;
+    node.rChild = child_bounds(rArea);
+    node.aggregate = m_emptyAggregate;
+    return node;
+  }
+
+  bool can_split(const Node &node) const {
+    return node.nDepth + 1 < m_config.nMaxDepth
+        && std::min(node.rect.size.x, node.rect.size.y) / 2.0f >= m_config.fMinNodeSize;
+  }
+
+  // Same test as olc::rect::containsRect, on the bounds as NodeItems stores them
+  static bool fits(const olc::rect &r, float fMinX, float fMinY, float fMaxX, float fMaxY) {
+    return fMinX >= r.pos.x && fMaxX < r.pos.x + r.size.x && fMinY >= r.pos.y && fMaxY < r.pos.y + r.size.y;
+  }
+
+  // Child whose bounds fully contain the item's bounds, or -1 if none does. A loose tree only
+  // tries the quadrant holding the item's centre, so an item sinks as deep as its size allows.
+  int child_for(const Node &node, float fMinX, float fMinY, float fMaxX, float fMaxY) const {
+    if (m_config.fLooseness > 1.0f) {
+      const int i = ((fMinX + fMaxX) / 2.0f >= node.rect.pos.x + node.rect.size.x / 2.0f ? 1 : 0)
+          | ((fMinY + fMaxY) / 2.0f >= node.rect.pos.y + node.rect.size.y / 2.0f ? 2 : 0);
+      return fits(node.rChild[i], fMinX, fMinY, fMaxX, fMaxY) ? i : -1;
+    }
+
+    for (int i = 0; i < 4; i++) if (fits(node.rChild[i], fMinX, fMinY, fMaxX, fMaxY)) return i;
+    return -1;
+  }
+
+  // Whether an item with these bounds may stay in node n, the root takes anything
+  bool holds(uint32_t n, float fMinX, float fMinY, float fMaxX, float fMaxY) const {
+    const uint32_t p = m_nodes[n].nParent;
+    if (p == NONE) return true;
+    for (int i = 0; i < 4; i++)
+      if (m_nodes[p].nChild[i] == n) return fits(m_nodes[p].rChild[i], fMinX, fMinY, fMaxX, fMaxY);
+    return false;
+  }
+
+  // Records where the items of node n from slot nFrom onwards now live
+  void locate(uint32_t n, size_t nFrom) {
+    const NodeItems<Type> &items = m_nodes[n].items;
+    for (size_t k = nFrom; k < items.size(); k++) m_locations[items.vHandle[k]] = {n, uint32_t(k)};
+  }
+
+  // Takes an item out of its node, uncounting it from that node up to and including nUpTo (the
+  // root if NONE). Returns the item, nFrom is set to the node it was in.
+  Type detach(Handle h, uint32_t nUpTo, uint32_t &nFrom) {
+    const Location loc = m_locations[h];
+    NodeItems<Type> &items = m_nodes[loc.nNode].items;
+    for (uint32_t a = loc.nNode; ; a = m_nodes[a].nParent) {
+      m_nodes[a].nCount--;
+      m_nodes[a].aggregate.remove(items.vItem[loc.nSlot]);
+      if (a == nUpTo || m_nodes[a].nParent == NONE) break;
+    }
+
+    Type item = std::move(items.vItem[loc.nSlot]);
+    items.erase(loc.nSlot);
+    if (loc.nSlot < items.size()) m_locations[items.vHandle[loc.nSlot]].nSlot = loc.nSlot;
+    nFrom = loc.nNode;
+    return item;
+  }
+
+  // Collapses the highest ancestor of n (or n itself) whose subtree fell below the leaf capacity
+  void merge_up(uint32_t n) {
+    uint32_t nMerge = NONE;
+    for (uint32_t a = n; a != NONE; a = m_nodes[a].nParent)
+      if (m_nodes[a].bSplit && m_nodes[a].nCount < m_config.nLeafCapacity) nMerge = a;
+    if (nMerge != NONE) collapse(nMerge);
+  }
+
+  int child_for(const Node &node, const olc::rect &item_size) const {
+    return child_for(node, item_size.pos.x, item_size.pos.y, item_size.pos.x + item_size.size.x,
+                     item_size.pos.y + item_size.size.y);
+  }
+
+  // Index of child i of node n, allocating it (reusing a freed node if there is one) if missing
+  uint32_t child(uint32_t n, int i) {
+    if (m_nodes[n].nChild[i] == NONE) {
+      // Allocating may move the arena, so only index into it afterwards
+      Node node = make_node(m_nodes[n].nDepth + 1, quadrant(m_nodes[n].rect, i), n);
+      uint32_t c;
+      if (!m_freeNodes.empty()) {
+        c = m_freeNodes.back();
+        m_freeNodes.pop_back();
+        m_nodes[c] = std::move(node);
+      } else {
+        c = uint32_t(m_nodes.size());
+        m_nodes.push_back(std::move(node));
+      }
+      m_nodes[n].nChild[i] = c;
+    }
+    return m_nodes[n].nChild[i];
+  }
+
+  // Adds an item to the subtree at n, counting it in n and every node it passes on the way down
+  void insert(uint32_t n, Handle h, const Type &item, float fMinX, float fMinY, float fMaxX, float fMaxY) {
+    for (;;) {
+      m_nodes[n].nCount++;
+      m_nodes[n].aggregate.add(item);
+      if (!m_nodes[n].bSplit) break;
+      int i = child_for(m_nodes[n], fMinX, fMinY, fMaxX, fMaxY);
+      if (i < 0) break;
+      n = child(n, i);
+    }
+    m_locations[h] = {n, uint32_t(m_nodes[n].items.size())};
+    m_nodes[n].items.push_back(fMinX, fMinY, fMaxX, fMaxY, item, h);
+    if (!m_nodes[n].bSplit && m_nodes[n].items.size() > m_config.nLeafCapacity && can_split(m_nodes[n])) split(n);
+  }
+
+  // Turns leaf n into a split node, pushing every item that fits a child down into it
+  void split(uint32_t n) {
+    NodeItems<Type> vItems = std::move(m_nodes[n].items);
+    m_nodes[n].items.clear();
+    m_nodes[n].bSplit = true;
+    for (size_t k = 0; k < vItems.size(); k++) {
+      int i = child_for(m_nodes[n], vItems.vMinX[k], vItems.vMinY[k], vItems.vMaxX[k], vItems.vMaxY[k]);
+      if (i < 0) {
+        m_locations[vItems.vHandle[k]] = {n, uint32_t(m_nodes[n].items.size())};
+        m_nodes[n].items.push_back(vItems.vMinX[k], vItems.vMinY[k], vItems.vMaxX[k], vItems.vMaxY[k],
+                                   std::move(vItems.vItem[k]), vItems.vHandle[k]);
+      } else {
+        insert(child(n, i), vItems.vHandle[k], vItems.vItem[k],
+               vItems.vMinX[k], vItems.vMinY[k], vItems.vMaxX[k], vItems.vMaxY[k]);
+      }
+    }
+  }
+
+  // Pulls every item below n up into n and returns the emptied descendants to the free list
+  void collapse(uint32_t n) {
+    for (int i = 0; i < 4; i++) {
+      const uint32_t c = m_nodes[n].nChild[i];
+      if (c == NONE) continue;
+      collapse(c);
+      const size_t nFrom = m_nodes[n].items.size();
+      m_nodes[n].items.append(m_nodes[c].items);
+      locate(n, nFrom);
+      m_nodes[c] = Node();
+      m_freeNodes.push_back(c);
+      m_nodes[n].nChild[i] = NONE;
+    }
+    m_nodes[n].bSplit = false;
+  }
+
+  // Splits and merges the subtree at n until it follows the current config
+  void rebalance(uint32_t n) {
+    if (m_nodes[n].bSplit && (m_nodes[n].nCount < m_config.nLeafCapacity || !can_split(m_nodes[n]))) collapse(n);
+
+    if (!m_nodes[n].bSplit) {
+      // split() already leaves the new children following the config
+      if (m_nodes[n].items.size() > m_config.nLeafCapacity && can_split(m_nodes[n])) split(n);
+      return;
+    }
+    for (int i = 0; i < 4; i++) if (m_nodes[n].nChild[i] != NONE) rebalance(m_nodes[n].nChild[i]);
+  }
+
+  // Places the nCount items indexed by pIndex into node n of vNodes and below. Items are
+  // bucketed by child quadrant into pScratch, so each child's items end up as one contiguous
+  // run of pIndex which is then built recursively. While nParallelLevels remains, children
+  // with enough items are built as pool tasks into private arenas, which are spliced onto
+  // vNodes once they are done, while one more task builds the other children in place.
+  void build(std::vector<Node> &vNodes, uint32_t n, std::span<const std::pair<Type, olc::rect>> vItems,
+             uint32_t *pIndex, uint32_t *pScratch, int8_t *pQuad, size_t nCount, int nParallelLevels) const {
+    vNodes[n].nCount = nCount;
+    if (nCount <= m_config.nLeafCapacity || !can_split(vNodes[n])) {
+      vNodes[n].items.reserve(nCount);
+      for (size_t k = 0; k < nCount; k++) {
+        vNodes[n].items.push_back(vItems[pIndex[k]].second, vItems[pIndex[k]].first, pIndex[k]);
+        vNodes[n].aggregate.add(vItems[pIndex[k]].first);
+      }
+      return;
+    }
+    vNodes[n].bSplit = true;
+
+    // Bucket 0 holds the items staying in this node, 1 to 4 the items for each child
+    std::array<size_t, 6> nBucket{};
+    for (size_t k = 0; k < nCount; k++) {
+      pQuad[k] = int8_t(child_for(vNodes[n], vItems[pIndex[k]].second));
+      nBucket[pQuad[k] + 2]++;
+    }
+    for (int b = 1; b < 6; b++) nBucket[b] += nBucket[b - 1];
+
+    std::array<size_t, 6> nNext = nBucket;
+    for (size_t k = 0; k < nCount; k++) pScratch[nNext[pQuad[k] + 1]++] = pIndex[k];
+    std::copy(pScratch, pScratch + nCount, pIndex);
+
+    vNodes[n].items.reserve(nBucket[1]);
+    for (size_t k = 0; k < nBucket[1]; k++) {
+      vNodes[n].items.push_back(vItems[pIndex[k]].second, vItems[pIndex[k]].first, pIndex[k]);
+      vNodes[n].aggregate.add(vItems[pIndex[k]].first);
+    }
+
+    // Children big enough to be built as tasks of their own, each started in a private arena
+    std::array<int, 4> vParallel{};
+    std::array<bool, 4> bParallel{};
+    std::array<std::vector<Node>, 4> vSubtree;
+    size_t nParallel = 0;
+    for (int i = 0; i < 4; i++) {
+      if (nParallelLevels == 0 || nBucket[i + 2] - nBucket[i + 1] < PARALLEL_BUILD_MIN_ITEMS) continue;
+      bParallel[i] = true;
+      vSubtree[nParallel].push_back(make_node(vNodes[n].nDepth + 1, quadrant(vNodes[n].rect, i), n));
+      vParallel[nParallel++] = i;
+    }
+
+    // Task 0 builds the other children straight into vNodes, which no other task touches
+    auto build_children = [&](size_t t) {
+      if (t > 0) {
+        const int i = vParallel[t - 1];
+        build(vSubtree[t - 1], 0, vItems, pIndex + nBucket[i + 1], pScratch + nBucket[i + 1], pQuad + nBucket[i + 1],
+              nBucket[i + 2] - nBucket[i + 1], nParallelLevels - 1);
+        return;
+      }
+      for (int i = 0; i < 4; i++) {
+        const size_t nBegin = nBucket[i + 1], nEnd = nBucket[i + 2];
+        if (nBegin == nEnd || bParallel[i]) continue;
+        const uint32_t c = uint32_t(vNodes.size());
+        vNodes[n].nChild[i] = c;
+        vNodes.push_back(make_node(vNodes[n].nDepth + 1, quadrant(vNodes[n].rect, i), n));
+        build(vNodes, c, vItems, pIndex + nBegin, pScratch + nBegin, pQuad + nBegin, nEnd - nBegin,
+              nParallelLevels - 1);
+      }
+    };
+    if (nParallel == 0) {
+      build_children(0);
+    } else {
+      TaskPool::shared().run(nParallel + 1, build_children);
+    }
+
+    for (size_t t = 0; t < nParallel; t++) {
+      const int i = vParallel[t];
+      const uint32_t nOffset = uint32_t(vNodes.size());
+      for (auto &node : vSubtree[t]) {
+        for (auto &c : node.nChild) if (c != NONE) c += nOffset;
+        // The subtree's root was made with n as its parent already, the rest are private indices
+        node.nParent = (&node == &vSubtree[t].front()) ? n : node.nParent + nOffset;
+        vNodes.push_back(std::move(node));
+      }
+      vNodes[n].nChild[i] = nOffset;
+    }
+
+    for (uint32_t c : vNodes[n].nChild) if (c != NONE) vNodes[n].aggregate.add(vNodes[c].aggregate);
+  }
+
+  template<typename Fn>
+  void search(uint32_t n, const olc::rect &rArea, Fn &fn) const {
+    const Node &node = m_nodes[n];
+    node.items.search(rArea, fn);
+
+    for (int i = 0; i < 4; i++) {
+      if (node.nChild[i] != NONE) {
+
+        if (rArea.containsRect(node.rChild[i])) {
+          items(node.nChild[i], fn);
+        } else if (rArea.overlaps(node.rChild[i])) {
+          search(node.nChild[i], rArea, fn);
+        }
+      }
+    }
+  }
+
+  size_t count(uint32_t n, const olc::rect &rArea) const {
+    const Node &node = m_nodes[n];
+    size_t nCount = node.items.count(rArea);
+
+    for (int i = 0; i < 4; i++) {
+      if (node.nChild[i] != NONE) {
+
+        if (rArea.containsRect(node.rChild[i])) {
+          nCount += m_nodes[node.nChild[i]].nCount;
+        } else if (rArea.overlaps(node.rChild[i])) {
+          nCount += count(node.nChild[i], rArea);
+        }
+      }
+    }
+    return nCount;
+  }
+
+  template<typename FnItem>
+  void lod_search(uint32_t n, const olc::rect &rArea, float fMinNodeSize, LodGrid<Aggregate> &cells,
+                  FnItem &fnItem) const {
+    const Node &node = m_nodes[n];
+    if (node.nCount == 0) return;
+    if (node.rect.size.x < fMinNodeSize && node.rect.size.y < fMinNodeSize) {
+      const olc::vf2d vCentre = node.rect.pos + node.rect.size * 0.5f;
+      cells.add_subtree(vCentre.x, vCentre.y, node.nCount, node.aggregate);
+      return;
+    }
+
+    const NodeItems<Type> &vItems = node.items;
+    vItems.search_index(rArea, [&](size_t i) {
+      if (vItems.vMaxX[i] - vItems.vMinX[i] < fMinNodeSize && vItems.vMaxY[i] - vItems.vMinY[i] < fMinNodeSize) {
+        cells.add_item((vItems.vMinX[i] + vItems.vMaxX[i]) * 0.5f, (vItems.vMinY[i] + vItems.vMaxY[i]) * 0.5f,
+                       vItems.vItem[i]);
+      } else {
+        fnItem(vItems.vItem[i]);
+      }
+    });
+    for (int i = 0; i < 4; i++) {
+      if (node.nChild[i] != NONE && rArea.overlaps(node.rChild[i]))
+        lod_search(node.nChild[i], rArea, fMinNodeSize, cells, fnItem);
+    }
+  }
+
+  // Squared distance from p to the nearest point of the box, 0 if p is inside it
+  static float distance2(const olc::vf2d &p, float fMinX, float fMinY, float fMaxX, float fMaxY) {
+    const float dx = std::max({fMinX - p.x, 0.0f, p.x - fMaxX});
+    const float dy = std::max({fMinY - p.y, 0.0f, p.y - fMaxY});
+    return dx * dx + dy * dy;
+  }
+
+  static bool less_distance(const std::pair<float, Location> &a, const std::pair<float, Location> &b) {
+    return a.first < b.first;
+  }
+
+  // Whether item i of a and item j of b overlap or touch
+  static bool touches(const NodeItems<Type> &a, size_t i, const NodeItems<Type> &b, size_t j) {
+    return a.vMinX[i] <= b.vMaxX[j] && b.vMinX[j] <= a.vMaxX[i] && a.vMinY[i] <= b.vMaxY[j]
+        && b.vMinY[j] <= a.vMaxY[i];
+  }
+
+  // Whether item i of v overlaps or touches r
+  static bool touches(const NodeItems<Type> &v, size_t i, const olc::rect &r) {
+    return v.vMinX[i] <= r.pos.x + r.size.x && r.pos.x <= v.vMaxX[i] && v.vMinY[i] <= r.pos.y + r.size.y
+        && r.pos.y <= v.vMaxY[i];
+  }
+
+  // Items from this or another tree are carried down a subtree as probes, see ItemProbe
+  template<typename Item>
+  using Probe = ItemProbe<Item>;
+
+  // Appends item i of node n to vProbes
+  void push_probe(uint32_t n, size_t i, std::vector<Probe<Type>> &vProbes) const {
+    const NodeItems<Type> &vItems = m_nodes[n].items;
+    vProbes.push_back({vItems.vMinX[i], vItems.vMinY[i], vItems.vMaxX[i], vItems.vMaxY[i], &vItems.vItem[i]});
+  }
+
+  // Appends the probes from vProbes[nBegin] up to vProbes[nEnd] that reach r
+  template<typename Item>
+  static void push_touching(const olc::rect &r, std::vector<Probe<Item>> &vProbes, size_t nBegin, size_t nEnd) {
+    for (size_t a = nBegin; a < nEnd; a++) {
+      const Probe<Item> probe = vProbes[a];
+      if (probe.touches(r)) vProbes.push_back(probe);
+    }
+  }
+
+  // fn(probe, item) for the probes from vProbes[nBegin] onwards and node n's items they touch
+  template<typename Item, typename Fn>
+  void probe_node(uint32_t n, const std::vector<Probe<Item>> &vProbes, size_t nBegin, Fn &fn) const {
+    const NodeItems<Type> &vItems = m_nodes[n].items;
+    for (size_t a = nBegin; a < vProbes.size(); a++) {
+      const Probe<Item> &probe = vProbes[a];
+      for (size_t i = 0; i < vItems.size(); i++) {
+        if (probe.fMinX <= vItems.vMaxX[i] && vItems.vMinX[i] <= probe.fMaxX && probe.fMinY <= vItems.vMaxY[i]
+            && vItems.vMinY[i] <= probe.fMaxY)
+          fn(*probe.pItem, vItems.vItem[i]);
+      }
+    }
+  }
+
+  // fn(probe, item) for the probes from vProbes[nBegin] onwards and every item they touch in
+  // node n's subtree. The probes reaching each child are appended and dropped again after it.
+  template<typename Item, typename Fn>
+  void probe_subtree(uint32_t n, std::vector<Probe<Item>> &vProbes, size_t nBegin, Fn &fn) const {
+    const Node &node = m_nodes[n];
+    const size_t nEnd = vProbes.size();
+    probe_node(n, vProbes, nBegin, fn);
+
+    for (int c = 0; c < 4; c++) {
+      if (node.nChild[c] == NONE || m_nodes[node.nChild[c]].nCount == 0) continue;
+      push_touching(node.rChild[c], vProbes, nBegin, nEnd);
+      if (vProbes.size() > nEnd) probe_subtree(node.nChild[c], vProbes, nEnd, fn);
+      vProbes.resize(nEnd);
+    }
+  }
+
+  // Pairs within node n's subtree, plus those between it and the probes from vProbes[nBegin]
+  // onwards, which are items of its ancestors
+  template<typename Fn>
+  void overlapping_pairs(uint32_t n, std::vector<Probe<Type>> &vProbes, size_t nBegin, Fn &fn) const {
+    const Node &node = m_nodes[n];
+    const NodeItems<Type> &vItems = node.items;
+    const size_t nEnd = vProbes.size();
+
+    probe_node(n, vProbes, nBegin, fn);
+    for (size_t i = 0; i < vItems.size(); i++) {
+      for (size_t j = i + 1; j < vItems.size(); j++)
+        if (touches(vItems, i, vItems, j)) fn(vItems.vItem[i], vItems.vItem[j]);
+    }
+
+    for (int c = 0; c < 4; c++) {
+      if (node.nChild[c] == NONE || m_nodes[node.nChild[c]].nCount == 0) continue;
+      push_touching(node.rChild[c], vProbes, nBegin, nEnd);
+      for (size_t i = 0; i < vItems.size(); i++)
+        if (touches(vItems, i, node.rChild[c])) push_probe(n, i, vProbes);
+
+      overlapping_pairs(node.nChild[c], vProbes, nEnd, fn);
+      vProbes.resize(nEnd);
+    }
+
+    // Items in sibling subtrees can only meet if the children's bounds overlap, as they do
+    // in a loose tree
+    if (m_config.fLooseness <= 1.0f) return;
+    for (int c = 0; c < 4; c++) {
+      for (int d = c + 1; d < 4; d++) {
+        if (node.nChild[c] == NONE || node.nChild[d] == NONE) continue;
+        if (!node.rChild[c].overlaps(node.rChild[d])) continue;
+        cross_pairs(node.nChild[c], node.nChild[d], node.rChild[d], vProbes, fn);
+      }
+    }
+  }
+
+  // Pairs between subtree a and subtree b, whose items lie within rB. Each node under a sends
+  // the items that reach rB down b's subtree.
+  template<typename Fn>
+  void cross_pairs(uint32_t a, uint32_t b, const olc::rect &rB, std::vector<Probe<Type>> &vProbes, Fn &fn) const {
+    if (m_nodes[a].nCount == 0 || m_nodes[b].nCount == 0) return;
+    const size_t nBegin = vProbes.size();
+    for (size_t i = 0; i < m_nodes[a].items.size(); i++)
+      if (touches(m_nodes[a].items, i, rB)) push_probe(a, i, vProbes);
+    if (vProbes.size() > nBegin) probe_subtree(b, vProbes, nBegin, fn);
+    vProbes.resize(nBegin);
+
+    for (int c = 0; c < 4; c++) {
+      const uint32_t nChild = m_nodes[a].nChild[c];
+      if (nChild != NONE && m_nodes[a].rChild[c].overlaps(rB)) cross_pairs(nChild, b, rB, vProbes, fn);
+    }
+  }
+
+  // Pairs between node a's subtree here and node b's subtree in other, whose bounds are *pB,
+  // or nullptr for its root which can hold anything. Made up of a's items against all of b's
+  // subtree, b's items against each of a's child subtrees, and the joins of every pair of
+  // children whose bounds overlap.
+  template<typename Other, typename OtherAggregate, typename Fn>
+  void join(uint32_t a, const StaticQuadTree<Other, OtherAggregate> &other, uint32_t b, const olc::rect *pB,
+            std::vector<Probe<Type>> &vMine, std::vector<Probe<Other>> &vTheirs, Fn &fn) const {
+    const Node &nodeA = m_nodes[a];
+    const auto &nodeB = other.m_nodes[b];
+    if (nodeA.nCount == 0 || nodeB.nCount == 0) return;
+
+    for (size_t i = 0; i < nodeA.items.size(); i++)
+      if (!pB || touches(nodeA.items, i, *pB)) push_probe(a, i, vMine);
+    if (!vMine.empty()) other.probe_subtree(b, vMine, 0, fn);
+    vMine.clear();
+
+    auto fnSwapped = [&](const Other &theirs, const Type &mine) { fn(mine, theirs); };
+    for (int c = 0; c < 4; c++) {
+      if (nodeA.nChild[c] == NONE) continue;
+      for (size_t i = 0; i < nodeB.items.size(); i++)
+        if (other.touches(nodeB.items, i, nodeA.rChild[c])) other.push_probe(b, i, vTheirs);
+      if (!vTheirs.empty()) probe_subtree(nodeA.nChild[c], vTheirs, 0, fnSwapped);
+      vTheirs.clear();
+    }
+
+    for (int c = 0; c < 4; c++) {
+      if (nodeA.nChild[c] == NONE) continue;
+      for (int d = 0; d < 4; d++) {
+        if (nodeB.nChild[d] == NONE || !nodeA.rChild[c].overlaps(nodeB.rChild[d])) continue;
+        join(nodeA.nChild[c], other, nodeB.nChild[d], &nodeB.rChild[d], vMine, vTheirs, fn);
+      }
+    }
+  }
+
+  // Interleaves the bits of two 16-bit coordinates into a Morton code
+  static uint32_t morton(uint32_t x, uint32_t y) {
+    auto spread = [](uint32_t v) {
+      v = (v | (v << 8)) & 0x00FF00FFu;
+      v = (v | (v << 4)) & 0x0F0F0F0Fu;
+      v = (v | (v << 2)) & 0x33333333u;
+      v = (v | (v << 1)) & 0x55555555u;
+      return v;
+    };
+    return spread(x) | (spread(y) << 1);
+  }
+
+  // A convex polygon's separating axes, worked out once per search_polygon() call
+  struct PolygonAxes {
+    float fMinX, fMinY, fMaxX, fMaxY; // bounds along the x and y axes
+    std::vector<olc::vf2d> vNormal; // outward normal of each edge
+    std::vector<float> vLow, vHigh; // extent of the polygon along each normal
+
+    explicit PolygonAxes(std::span<const olc::vf2d> vPolygon) {
+      fMinX = fMaxX = vPolygon[0].x;
+      fMinY = fMaxY = vPolygon[0].y;
+      olc::vf2d vCentre;
+      for (auto const &v : vPolygon) {
+        fMinX = std::min(fMinX, v.x);
+        fMinY = std::min(fMinY, v.y);
+        fMaxX = std::max(fMaxX, v.x);
+        fMaxY = std::max(fMaxY, v.y);
+        vCentre += v;
+      }
+      vCentre /= float(vPolygon.size());
+
+      for (size_t i = 0; i < vPolygon.size() && vPolygon.size() > 1; i++) {
+        const olc::vf2d a = vPolygon[i], b = vPolygon[(i + 1) % vPolygon.size()];
+        olc::vf2d vNorm = {b.y - a.y, a.x - b.x};
+        // Point away from the inside, whichever way the polygon winds
+        if (vNorm.dot(vCentre - a) > 0.0f) vNorm = -vNorm;
+
+        float fLow = vNorm.dot(a), fHigh = fLow;
+        for (auto const &v : vPolygon) {
+          fLow = std::min(fLow, vNorm.dot(v));
+          fHigh = std::max(fHigh, vNorm.dot(v));
+        }
+        vNormal.push_back(vNorm);
+        vLow.push_back(fLow);
+        vHigh.push_back(fHigh);
+      }
+    }
+
+    // True unless one of the axes separates the box from the polygon
+    bool overlaps(float fBoxMinX, float fBoxMinY, float fBoxMaxX, float fBoxMaxY) const {
+      if (fBoxMinX > fMaxX || fBoxMaxX < fMinX || fBoxMinY > fMaxY || fBoxMaxY < fMinY) return false;
+      const olc::vf2d vCentre = {(fBoxMinX + fBoxMaxX) * 0.5f, (fBoxMinY + fBoxMaxY) * 0.5f};
+      const olc::vf2d vHalf = {(fBoxMaxX - fBoxMinX) * 0.5f, (fBoxMaxY - fBoxMinY) * 0.5f};
+      for (size_t i = 0; i < vNormal.size(); i++) {
+        const float fMid = vNormal[i].dot(vCentre);
+        const float fRadius = vHalf.x * std::abs(vNormal[i].x) + vHalf.y * std::abs(vNormal[i].y);
+        if (fMid - fRadius > vHigh[i] || fMid + fRadius < vLow[i]) return false;
+      }
+      return true;
+    }
+
+    // True if the box lies entirely within the polygon, on the inner side of every edge
+    bool contains(const olc::rect &r) const {
+      if (vNormal.size() < 3) return false;
+      const olc::vf2d vCentre = r.pos + r.size * 0.5f;
+      for (size_t i = 0; i < vNormal.size(); i++) {
+        const float fRadius = r.size.x * 0.5f * std::abs(vNormal[i].x) + r.size.y * 0.5f * std::abs(vNormal[i].y);
+        if (vNormal[i].dot(vCentre) + fRadius > vHigh[i]) return false;
+      }
+      return true;
+    }
+  };
+
+  template<typename Fn>
+  void search_polygon(uint32_t n, const PolygonAxes &polygon, Fn &fn) const {
+    const Node &node = m_nodes[n];
+    const NodeItems<Type> &vItems = node.items;
+    for (size_t i = 0; i < vItems.size(); i++) {
+      if (polygon.overlaps(vItems.vMinX[i], vItems.vMinY[i], vItems.vMaxX[i], vItems.vMaxY[i])) fn(vItems.vItem[i]);
+    }
+
+    for (int i = 0; i < 4; i++) {
+      if (node.nChild[i] == NONE) continue;
+      const olc::rect &r = node.rChild[i];
+      if (polygon.contains(r)) {
+        items(node.nChild[i], fn);
+      } else if (polygon.overlaps(r.pos.x, r.pos.y, r.pos.x + r.size.x, r.pos.y + r.size.y)) {
+        search_polygon(node.nChild[i], polygon, fn);
+      }
+    }
+  }
+
+  // t at which the segment vOrigin + t * vDir, 0 <= t <= fMaxT, enters the box, 0 if it starts
+  // inside, or a negative value if it misses
+  static float ray_entry(const olc::vf2d &vOrigin, const olc::vf2d &vDir, float fMaxT,
+                         float fMinX, float fMinY, float fMaxX, float fMaxY) {
+    float tNear = 0.0f, tFar = fMaxT;
+    auto slab = [&](float o, float d, float fMin, float fMax) {
+      if (d == 0.0f) {
+        // Parallel to this slab, so either always within it or never
+        if (o < fMin || o > fMax) tFar = -1.0f;
+        return;
+      }
+      float t0 = (fMin - o) / d, t1 = (fMax - o) / d;
+      if (t0 > t1) std::swap(t0, t1);
+      tNear = std::max(tNear, t0);
+      tFar = std::min(tFar, t1);
+    };
+    slab(vOrigin.x, vDir.x, fMinX, fMaxX);
+    slab(vOrigin.y, vDir.y, fMinY, fMaxY);
+    return tNear <= tFar ? tNear : -1.0f;
+  }
+
+  // Walks the nodes the segment crosses nearest first, calling fn(item, t) for each item hit.
+  // fn returns the t further hits must come before to be wanted, nodes entered at or beyond
+  // that are not walked.
+  template<typename Fn>
+  void ray_walk(const olc::vf2d &vOrigin, const olc::vf2d &vDir, float fMaxT, Fn &&fn) const {
+    float fLimit = std::numeric_limits<float>::infinity();
+    // Nodes still to visit as (entry t, node), nearest on top. The root can hold items outside
+    // the tree's area, so it is always visited.
+    std::priority_queue<std::pair<float, uint32_t>, std::vector<std::pair<float, uint32_t>>, std::greater<>> queue;
+    queue.push({0.0f, 0});
+
+    while (!queue.empty()) {
+      const auto [fNodeT, n] = queue.top();
+      if (fNodeT >= fLimit) break;
+      queue.pop();
+
+      const Node &node = m_nodes[n];
+      const NodeItems<Type> &vItems = node.items;
+      for (size_t i = 0; i < vItems.size(); i++) {
+        const float t = ray_entry(vOrigin, vDir, fMaxT, vItems.vMinX[i], vItems.vMinY[i], vItems.vMaxX[i],
+                                  vItems.vMaxY[i]);
+        if (t >= 0.0f && t < fLimit) fLimit = fn(vItems.vItem[i], t);
+      }
+
+      for (int i = 0; i < 4; i++) {
+        if (node.nChild[i] == NONE || m_nodes[node.nChild[i]].nCount == 0) continue;
+        const olc::rect &r = node.rChild[i];
+        const float t = ray_entry(vOrigin, vDir, fMaxT, r.pos.x, r.pos.y, r.pos.x + r.size.x, r.pos.y + r.size.y);
+        if (t >= 0.0f && t < fLimit) queue.push({t, node.nChild[i]});
+      }
+    }
+  }
+
+  // Squared distance from p to the farthest corner of r
+  static float farthest2(const olc::vf2d &p, const olc::rect &r) {
+    const float dx = std::max(p.x - r.pos.x, r.pos.x + r.size.x - p.x);
+    const float dy = std::max(p.y - r.pos.y, r.pos.y + r.size.y - p.y);
+    return dx * dx + dy * dy;
+  }
+
+  template<typename Fn>
+  void search_circle(uint32_t n, const olc::vf2d &vCenter, float fRadius2, Fn &fn) const {
+    const Node &node = m_nodes[n];
+    const NodeItems<Type> &vItems = node.items;
+    for (size_t i = 0; i < vItems.size(); i++) {
+      if (distance2(vCenter, vItems.vMinX[i], vItems.vMinY[i], vItems.vMaxX[i], vItems.vMaxY[i]) <= fRadius2)
+        fn(vItems.vItem[i]);
+    }
+
+    for (int i = 0; i < 4; i++) {
+      if (node.nChild[i] == NONE) continue;
+      const olc::rect &r = node.rChild[i];
+      if (farthest2(vCenter, r) <= fRadius2) {
+        items(node.nChild[i], fn);
+      } else if (distance2(vCenter, r.pos.x, r.pos.y, r.pos.x + r.size.x, r.pos.y + r.size.y) <= fRadius2) {
+        search_circle(node.nChild[i], vCenter, fRadius2, fn);
+      }
+    }
+  }
+
+  template<typename Fn>
+  void query_point(uint32_t n, const olc::rect &rPoint, Fn &fn) const {
+    const Node &node = m_nodes[n];
+    node.items.search(rPoint, fn);
+    for (int i = 0; i < 4; i++)
+      if (node.nChild[i] != NONE && node.rChild[i].containsPoint(rPoint.pos)) query_point(node.nChild[i], rPoint, fn);
+  }
+
+  const Type *query_point(uint32_t n, const olc::rect &rPoint) const {
+    const Node &node = m_nodes[n];
+    const size_t nSlot = node.items.find_first(rPoint);
+    if (nSlot < node.items.size()) return &node.items.vItem[nSlot];
+
+    for (int i = 0; i < 4; i++) {
+      if (node.nChild[i] != NONE && node.rChild[i].containsPoint(rPoint.pos)) {
+        if (const Type *pItem = query_point(node.nChild[i], rPoint)) return pItem;
+      }
+    }
+    return nullptr;
+  }
+
+  template<typename Fn>
+  void items(uint32_t n, Fn &fn) const {
+    const Node &node = m_nodes[n];
+    for (size_t i = 0; i < node.items.size(); i++) fn(node.items.vItem[i]);
+
+    for (int i = 0; i < 4; i++) if (node.nChild[i] != NONE) items(node.nChild[i], fn);
+  }
+
+  size_t m_depth = 0;
+  QuadTreeConfig m_config;
+  olc::rect m_rect; // dimensions of the whole tree
+  std::vector<Node> m_nodes; // node arena, the root is always m_nodes[0]
+  std::vector<uint32_t> m_freeNodes; // arena slots released by merging, reused before growing the arena
+  std::vector<Location> m_locations; // indexed by Handle
+  std::vector<Handle> m_freeHandles; // handles of removed items, reused by insert()
+  [[no_unique_address]] Aggregate m_emptyAggregate; // what every new node's aggregate starts as
+
+  // join() walks the other tree's nodes directly
+  template<typename, typename> friend class StaticQuadTree;
+};
+// Backing store for StaticQuadTreeContainer. Items live in fixed size chunks that never move,
+// so references to them stay valid as other items come and go, and are named by a compact
+// 32-bit id. Ids of erased items are reused by later inserts, keeping the chunks dense.
+template<typename Type>
+class SlotMap {
+ public:
+  using Id = uint32_t;
+
+  static constexpr uint32_t CHUNK_BITS = 10;
+  static constexpr uint32_t CHUNK_SIZE = 1 << CHUNK_BITS;
+
+  // Visits the live items in id order, skipping erased slots
+  template<bool bConst>
+  class Iterator {
+   public:
+    using value_type = Type;
+    using difference_type = std::ptrdiff_t;
+    using reference = std::conditional_t<bConst, const Type &, Type &>;
+
+    Iterator() = default;
+    Iterator(const SlotMap *pMap, Id id) : m_pMap(pMap), m_id(id) { skip(); }
+
+    reference operator*() const { return (*m_pMap)[m_id]; }
+    auto operator->() const { return &**this; }
+
+    Iterator &operator++() {
+      m_id++;
+      skip();
+      return *this;
+    }
+
+    Iterator operator++(int) {
+      Iterator it = *this;
+      ++*this;
+      return it;
+    }
+
+    bool operator==(const Iterator &other) const { return m_id == other.m_id; }
+
+    Id id() const { return m_id; }
+
+   private:
+    void skip() {
+      while (m_id < m_pMap->m_nSlots && !m_pMap->slot(m_id)) m_id++;
+    }
+
+    const SlotMap *m_pMap = nullptr;
+    Id m_id = 0;
+  };
+
+  using iterator = Iterator<false>;
+  using const_iterator = Iterator<true>;
+
+  Id insert(const Type &item) {
+    Id id;
+    if (!m_freeIds.empty()) {
+      id = m_freeIds.back();
+      m_freeIds.pop_back();
+    } else {
+      id = m_nSlots++;
+      if ((id >> CHUNK_BITS) == m_chunks.size())
+        m_chunks.push_back(std::make_unique<std::optional<Type>[]>(CHUNK_SIZE));
+    }
+    slot(id).emplace(item);
+    m_nSize++;
+    return id;
+  }
+
+  void erase(Id id) {
+    slot(id).reset();
+    m_freeIds.push_back(id);
+    m_nSize--;
+  }
+
+  // Destroys every item, keeping the chunks for the next inserts
+  void clear() {
+    for (Id id = 0; id < m_nSlots; id++) slot(id).reset();
+    m_freeIds.clear();
+    m_nSlots = 0;
+    m_nSize = 0;
+  }
+
+  void reserve(size_t nCount) {
+    while (m_chunks.size() * CHUNK_SIZE < nCount)
+      m_chunks.push_back(std::make_unique<std::optional<Type>[]>(CHUNK_SIZE));
+  }
+
+  // Like a pointer, the item is not made const by the map being const
+  Type &operator[](Id id) const {
+    return *slot(id);
+  }
+
+  size_t size() const {
+    return m_nSize;
+  }
+
+  bool empty() const {
+    return m_nSize == 0;
+  }
+
+  iterator begin() { return {this, 0}; }
+  iterator end() { return {this, m_nSlots}; }
+  const_iterator begin() const { return {this, 0}; }
+  const_iterator end() const { return {this, m_nSlots}; }
+
+ private:
+  std::optional<Type> &slot(Id id) const {
+    return m_chunks[id >> CHUNK_BITS][id & (CHUNK_SIZE - 1)];
+  }
+
+  std::vector<std::unique_ptr<std::optional<Type>[]>> m_chunks;
+  std::vector<Id> m_freeIds; // ids of erased items, reused by insert()
+  Id m_nSlots = 0; // ids below this have been handed out at some point
+  size_t m_nSize = 0;
+};
+
+template<typename Type, typename Aggregate = NoAggregate>
+class StaticQuadTreeContainer {
+  // Items are kept in a SlotMap as we dont want pointers to be invalidated to objects stored
+  // in the tree should the contents of the tree change
+  using QuadTreeContainer = SlotMap<Type>;
+
+ public:
+  // Names an item in the container, search results are reported as these
+  using ItemId = typename QuadTreeContainer::Id;
+
+ protected:
+  // The tree holds ids, this hands the aggregate the objects they name instead
+  struct ItemAggregate : Aggregate {
+    const QuadTreeContainer *pItems = nullptr;
+    void add(ItemId id) { Aggregate::add((*pItems)[id]); }
+    void remove(ItemId id) { Aggregate::remove((*pItems)[id]); }
+    void add(const ItemAggregate &other) { Aggregate::add(static_cast<const Aggregate &>(other)); }
+  };
+  // Without an aggregate there is nothing to look up, so nodes need not carry the pointer
+  using NodeAggregate = std::conditional_t<std::is_same_v<Aggregate, NoAggregate>, NoAggregate, ItemAggregate>;
+
+  NodeAggregate empty_aggregate() const {
+    NodeAggregate aggregate;
+    if constexpr (!std::is_same_v<Aggregate, NoAggregate>) aggregate.pItems = &m_allItems;
+    return aggregate;
+  }
+
+  // The actual container
+  QuadTreeContainer m_allItems;
+
+  // Use our StaticQuadTree to store ids instead of objects - this reduces
+  // overheads when moving or copying objects
+  StaticQuadTree<ItemId, NodeAggregate> root;
+
+ public:
+  StaticQuadTreeContainer(const olc::rect &size = {{0.0f, 0.0f}, {100.0f, 100.0f}}, const size_t nDepth = 0,
+                          const QuadTreeConfig &config = {})
+      : root(nDepth, size, config, empty_aggregate()) {
+
+  }
+
+  // Bulk loads the given (item, area) pairs, see build()
+  StaticQuadTreeContainer(std::span<const std::pair<Type, olc::rect>> vItems,
+                          const olc::rect &size = {{0.0f, 0.0f}, {100.0f, 100.0f}}, const size_t nDepth = 0,
+                          const QuadTreeConfig &config = {})
+      : root(nDepth, size, config, empty_aggregate()) {
+    build(vItems);
+  }
+
+  // The tree's aggregates point back at this container's items
+  StaticQuadTreeContainer(const StaticQuadTreeContainer &) = delete;
+  StaticQuadTreeContainer &operator=(const StaticQuadTreeContainer &) = delete;
+
+  // Sets the spatial coverage area of the quadtree
+  // Invalidates tree
+  void resize(const olc::rect &rArea) {
+    root.resize(rArea);
+  }
+
+  // Changes how the tree subdivides, restructuring it in place
+  void set_config(const QuadTreeConfig &config) {
+    root.set_config(config);
+  }
+
+  // Returns number of items within tree
+  size_t size() const {
+    return m_allItems.size();
+  }
+
+  // Returns true if tree is empty
+  bool empty() const {
+    return m_allItems.empty();
+  }
+
+  // Returns number of items within the search area, without visiting them
+  size_t count(const olc::rect &rArea) const {
+    return root.count(rArea);
+  }
+
+  // Cells filled by lod_search(), reporting each cell's merged Aggregate
+  using LodCells = LodGrid<NodeAggregate>;
+
+  // Visits items in the search area, but pools items and subtrees narrower than fMinNodeSize
+  // into the cells of a grid the caller keeps, see StaticQuadTree::lod_search()
+  template<typename FnItem> requires std::invocable<FnItem &, Type &>
+  void lod_search(const olc::rect &rArea, float fMinNodeSize, LodCells &cells, FnItem &&fnItem) const {
+    root.lod_search(rArea, fMinNodeSize, cells, [&](ItemId id) { fnItem(m_allItems[id]); });
+  }
+
+  // Removes all items from tree
+  void clear() {
+    root.clear();
+    m_allItems.clear();
+  }
+
+  // The item named by an id from search()
+  Type &operator[](ItemId id) const {
+    return m_allItems[id];
+  }
+
+  // Convenience functions for ranged for loop
+  typename QuadTreeContainer::iterator begin() {
+    return m_allItems.begin();
+  }
+
+  typename QuadTreeContainer::iterator end() {
+    return m_allItems.end();
+  }
+
+  typename QuadTreeContainer::const_iterator cbegin() const {
+    return m_allItems.begin();
+  }
+
+  typename QuadTreeContainer::const_iterator cend() const {
+    return m_allItems.end();
+  }
+
+  // The returned id names the item in search results, remove() and relocate()
+  ItemId insert(const Type &item, const olc::rect &itemsize) {
+    // Item is stored in container
+    const ItemId id = m_allItems.insert(item);
+
+    // Id/Area of item is stored in quad tree, under the id as its handle
+    root.insert(id, itemsize, id);
+    return id;
+  }
+
+  void remove(ItemId id) {
+    root.remove(id);
+    m_allItems.erase(id);
+  }
+
+  // Moves an item to a new area, only touching the tree structure if it leaves its node
+  void relocate(ItemId id, const olc::rect &itemsize) {
+    root.relocate(id, itemsize);
+  }
+
+  // Moves many items at once, see StaticQuadTree::update_all()
+  void update_all(std::span<const std::pair<ItemId, olc::rect>> vMoves) {
+    root.update_all(vMoves);
+  }
+
+  // Replaces the contents with the given (item, area) pairs, building the tree in one pass
+  // rather than inserting each item from the root. Item i gets id i, which is also its handle
+  // in the tree.
+  void build(std::span<const std::pair<Type, olc::rect>> vItems) {
+    clear();
+    m_allItems.reserve(vItems.size());
+    std::vector<std::pair<ItemId, olc::rect>> vIds;
+    vIds.reserve(vItems.size());
+    for (auto const &p : vItems) vIds.push_back({m_allItems.insert(p.first), p.second});
+    root.build(vIds);
+  }
+
+  // Returns a std::list of ids of items within the search area
+  [[nodiscard]] std::list<ItemId> search(const olc::rect &rArea) const {
+    std::list<ItemId> listItemIds;
+    root.search(rArea, listItemIds);
+    return listItemIds;
+  }
+
+  // Appends ids of items within the search area to a vector the caller keeps between
+  // searches, so steady-state searches reuse its capacity
+  void search(const olc::rect &rArea, std::vector<ItemId> &vItemIds) const {
+    root.search(rArea, vItemIds);
+  }
+
+  // Calls fn(item) for each item within the search area, without building a list
+  template<typename Fn> requires std::invocable<Fn &, Type &>
+  void search(const olc::rect &rArea, Fn &&fn) const {
+    root.search(rArea, [&](ItemId id) { fn(m_allItems[id]); });
+  }
+
+  // Lazy range of the items within the search area. The tree is only walked as far as the
+  // range is iterated, so a loop can stop after the first few hits.
+  [[nodiscard]] auto search_range(const olc::rect &rArea) const {
+    return root.search_range(rArea)
+        | std::views::transform([this](ItemId id) -> Type & { return m_allItems[id]; });
+  }
+
+  // Calls fn(item) for every item containing p, see StaticQuadTree::query_point()
+  template<typename Fn> requires std::invocable<Fn &, Type &>
+  void query_point(const olc::vf2d &p, Fn &&fn) const {
+    root.query_point(p, [&](ItemId id) { fn(m_allItems[id]); });
+  }
+
+  // First item found containing p, or nullptr
+  [[nodiscard]] Type *query_point(const olc::vf2d &p) const {
+    const ItemId *pId = root.query_point(p);
+    return pId ? &m_allItems[*pId] : nullptr;
+  }
+
+  // Calls fn(item) for every item within fRadius of vCenter, see StaticQuadTree::search_circle()
+  template<typename Fn> requires std::invocable<Fn &, Type &>
+  void search_circle(const olc::vf2d &vCenter, float fRadius, Fn &&fn) const {
+    root.search_circle(vCenter, fRadius, [&](ItemId id) { fn(m_allItems[id]); });
+  }
+
+  // Calls fn(a, b) once for every pair of items whose areas overlap or touch, see
+  // StaticQuadTree::for_each_overlapping_pair()
+  template<typename Fn> requires std::invocable<Fn &, Type &, Type &>
+  void for_each_overlapping_pair(Fn &&fn) const {
+    root.for_each_overlapping_pair([&](ItemId a, ItemId b) { fn(m_allItems[a], m_allItems[b]); });
+  }
+
+  // Calls fn(mine, theirs) for every pair of an item here and an item in other whose areas
+  // overlap or touch, see StaticQuadTree::join()
+  template<typename Other, typename OtherAggregate, typename Fn> requires std::invocable<Fn &, Type &, Other &>
+  void join(const StaticQuadTreeContainer<Other, OtherAggregate> &other, Fn &&fn) const {
+    root.join(other.root, [&](ItemId mine, ItemId theirs) { fn(m_allItems[mine], other.m_allItems[theirs]); });
+  }
+
+  // Appends ids of items within the search area to vItemIds using several threads, see
+  // StaticQuadTree::search_parallel()
+  void search_parallel(const olc::rect &rArea, std::vector<ItemId> &vItemIds, size_t nThreads = 0) const {
+    root.search_parallel(rArea, vItemIds, nThreads);
+  }
+
+  // Flat results of search_batch(), holding item ids
+  using BatchResult = typename decltype(root)::BatchResult;
+
+  // Runs many searches at once across threads, see StaticQuadTree::search_batch()
+  void search_batch(std::span<const olc::rect> vQueries, BatchResult &result, size_t nThreads = 0) const {
+    root.search_batch(vQueries, result, nThreads);
+  }
+
+  // Calls fn(item) for every item overlapping the convex polygon, see StaticQuadTree::search_polygon()
+  template<typename Fn> requires std::invocable<Fn &, Type &>
+  void search_polygon(std::span<const olc::vf2d> vPolygon, Fn &&fn) const {
+    root.search_polygon(vPolygon, [&](ItemId id) { fn(m_allItems[id]); });
+  }
+
+  // Calls fn(item, t) for every item the segment passes through, see StaticQuadTree::raycast()
+  template<typename Fn> requires std::invocable<Fn &, Type &, float>
+  void raycast(const olc::vf2d &vOrigin, const olc::vf2d &vDir, float fMaxT, Fn &&fn) const {
+    root.raycast(vOrigin, vDir, fMaxT, [&](ItemId id, float t) { fn(m_allItems[id], t); });
+  }
+
+  // Id of the first item along the segment and the t it is entered at, or nothing
+  [[nodiscard]] std::optional<std::pair<ItemId, float>> raycast(const olc::vf2d &vOrigin, const olc::vf2d &vDir,
+                                                                float fMaxT) const {
+    return root.raycast(vOrigin, vDir, fMaxT);
+  }
+
+  // Ids of the k items closest to p, nearest first, see StaticQuadTree::nearest()
+  [[nodiscard]] std::vector<ItemId> nearest(const olc::vf2d &p, size_t k) const {
+    return root.nearest(p, k);
+  }
+
+  // join() reads the other container's tree and items
+  template<typename, typename> friend class StaticQuadTreeContainer;
+};
+
+// Linear quadtree - the same subdivision as StaticQuadTree, but stored as one flat array of
+// nodes in Morton (preorder) order and built by sorting items on their cell's code. Every
+// subtree owns a contiguous run of items, so a fully covered subtree is a single linear
+// pass and a search is a forward walk over the node array with no recursion.
+template<typename Type>
+class LinearQuadTree {
+  // Cell key is the Morton code of the cell padded out to the deepest level, followed by the
+  // cell's level, so sorting puts every node's own items first and its descendants after them
+  static constexpr uint32_t LEVEL_BITS = 4;
+  static_assert(MAX_DEPTH <= (1u << LEVEL_BITS) && 2 * (MAX_DEPTH - 1) + LEVEL_BITS <= 32,
+                "cell keys no longer fit in 32 bits");
+
+ public:
+  LinearQuadTree(const olc::rect &rArea = {{0.0f, 0.0f}, {100000.0f, 100000.0f}}) : m_rect(rArea) {}
+
+  void resize(const olc::rect &rArea) {
+    m_rect = rArea;
+    clear();
+  }
+
+  void clear() {
+    m_nodes.clear();
+    m_items.clear();
+  }
+
+  size_t size() const {
+    return m_items.size();
+  }
+
+  // Replaces the contents of the tree with the given (item, area) pairs
+  void build(std::span<const std::pair<Type, olc::rect>> vItems) {
+    clear();
+
+    std::vector<uint32_t> vKeys(vItems.size());
+    std::vector<uint32_t> vOrder(vItems.size());
+    for (size_t i = 0; i < vItems.size(); i++) {
+      vKeys[i] = cell_key(vItems[i].second);
+      vOrder[i] = uint32_t(i);
+    }
+    radix_sort(vKeys, vOrder);
+
+    m_items.reserve(vItems.size());
+    for (uint32_t i : vOrder) m_items.push_back({vItems[i].second, vItems[i].first});
+
+    // Walk the sorted keys keeping the path from the root to the current cell open. A cell
+    // that is not below the top of the path closes nodes until it is, then opens the
+    // missing cells down to it - this emits the nodes in preorder.
+    struct Open {
+      uint32_t nNode;
+      uint32_t nLevel;
+      uint32_t nCode;
+    };
+    std::vector<Open> vPath;
+    auto open = [&](uint32_t nLevel, uint32_t nCode, const olc::rect &rArea, uint32_t nItem) {
+      vPath.push_back({uint32_t(m_nodes.size()), nLevel, nCode});
+      m_nodes.push_back({rArea, nItem, nItem, nItem, 0});
+    };
+    auto close = [&](uint32_t nItem) {
+      LinearNode &node = m_nodes[vPath.back().nNode];
+      node.nSubtreeEnd = nItem;
+      node.nSkip = uint32_t(m_nodes.size());
+      vPath.pop_back();
+    };
+
+    open(0, 0, m_rect, 0);
+    for (uint32_t i = 0; i < uint32_t(vKeys.size()); i++) {
+      const uint32_t nLevel = vKeys[i] & ((1u << LEVEL_BITS) - 1);
+      const uint32_t nCode = (vKeys[i] >> LEVEL_BITS) >> (2 * (MAX_DEPTH - 1 - nLevel));
+
+      while (vPath.back().nLevel > nLevel
+          || (nCode >> (2 * (nLevel - vPath.back().nLevel))) != vPath.back().nCode)
+        close(i);
+
+      while (vPath.back().nLevel < nLevel) {
+        const Open &parent = vPath.back();
+        const uint32_t nQuad = (nCode >> (2 * (nLevel - parent.nLevel - 1))) & 3;
+        open(parent.nLevel + 1, (parent.nCode << 2) | nQuad, child_rect(m_nodes[parent.nNode].rect, nQuad), i);
+      }
+
+      m_nodes[vPath.back().nNode].nItemsEnd = i + 1;
+    }
+    while (!vPath.empty()) close(uint32_t(m_items.size()));
+  }
+
+  [[nodiscard]] std::list<Type> search(const olc::rect &search_area) const {
+    std::list<Type> itemsInside;
+    search(search_area, itemsInside);
+    return itemsInside;
+  }
+
+  // Returns the objects in the given search area, by adding to supplied list
+  void search(const olc::rect &rArea, std::list<Type> &listItems) const {
+    search(rArea, [&](const Type &item) { listItems.push_back(item); });
+  }
+
+  // Appends the objects in the given search area to a caller-owned vector
+  void search(const olc::rect &rArea, std::vector<Type> &vItems) const {
+    search(rArea, [&](const Type &item) { vItems.push_back(item); });
+  }
+
+  // Calls fn(item) for each object in the given search area as the array is walked
+  template<typename Fn> requires std::invocable<Fn &, const Type &>
+  void search(const olc::rect &rArea, Fn &&fn) const {
+    // The root is always visited, it also holds any items that stick out of the tree's area
+    for (uint32_t n = 0; n < m_nodes.size();) {
+      const LinearNode &node = m_nodes[n];
+      if (n > 0 && !rArea.overlaps(node.rect)) {
+        n = node.nSkip;
+      } else if (n > 0 && rArea.containsRect(node.rect)) {
+        for (uint32_t i = node.nItemsBegin; i < node.nSubtreeEnd; i++) fn(m_items[i].second);
+        n = node.nSkip;
+      } else {
+        for (uint32_t i = node.nItemsBegin; i < node.nItemsEnd; i++)
+          if (rArea.overlaps(m_items[i].first)) fn(m_items[i].second);
+        n++;
+      }
+    }
+  }
+
+  void items(std::list<Type> &listItem) const {
+    for (auto const &p : m_items) listItem.push_back(p.second);
+  }
+
+  const olc::rect &area() { return m_rect; }
+
+ protected:
+  struct LinearNode {
+    olc::rect rect;
+    uint32_t nItemsBegin; // first item stored in this node (and its subtree)
+    uint32_t nItemsEnd; // one past the last item stored in this node itself
+    uint32_t nSubtreeEnd; // one past the last item stored anywhere below this node
+    uint32_t nSkip; // index of the next node after this subtree
+  };
+
+  // Same quadrant layout as StaticQuadTree: 0 top left, 1 top right, 2 bottom left, 3 bottom right
+  static olc::rect child_rect(const olc::rect &rArea, uint32_t nQuad) {
+    olc::vf2d vChildSize = rArea.size / 2.0f;
+    return olc::rect({rArea.pos.x + ((nQuad & 1) ? vChildSize.x : 0.0f),
+                      rArea.pos.y + ((nQuad & 2) ? vChildSize.y : 0.0f)}, vChildSize);
+  }
+
+  // Descends like StaticQuadTree::insert with its default config, pushing the item as deep as
+  // it fits, so both trees agree on where an item lives
+  uint32_t cell_key(const olc::rect &item_size) const {
+    olc::rect rCell = m_rect;
+    uint32_t nLevel = 0, nCode = 0;
+    while (nLevel + 1 < MAX_DEPTH) {
+      uint32_t nQuad = 0;
+      while (nQuad < 4 && !child_rect(rCell, nQuad).containsRect(item_size)) nQuad++;
+      if (nQuad == 4) break;
+      rCell = child_rect(rCell, nQuad);
+      nCode = (nCode << 2) | nQuad;
+      nLevel++;
+    }
+    return ((nCode << (2 * (MAX_DEPTH - 1 - nLevel))) << LEVEL_BITS) | nLevel;
+  }
+
+  // LSD radix sort of the keys, carrying the item order along. Passes over a byte that is
+  // the same in every key are skipped.
+  static void radix_sort(std::vector<uint32_t> &vKeys, std::vector<uint32_t> &vOrder) {
+    std::vector<uint32_t> vKeysTmp(vKeys.size()), vOrderTmp(vOrder.size());
+    for (uint32_t nShift = 0; nShift < 32; nShift += 8) {
+      std::array<size_t, 256> nCount{};
+      for (uint32_t k : vKeys) nCount[(k >> nShift) & 0xFF]++;
+      if (nCount[(vKeys.empty() ? 0 : vKeys[0] >> nShift) & 0xFF] == vKeys.size()) continue;
+
+      size_t nOffset = 0;
+      for (auto &c : nCount) {
+        size_t n = c;
+        c = nOffset;
+        nOffset += n;
+      }
+      for (size_t i = 0; i < vKeys.size(); i++) {
+        size_t dst = nCount[(vKeys[i] >> nShift) & 0xFF]++;
+        vKeysTmp[dst] = vKeys[i];
+        vOrderTmp[dst] = vOrder[i];
+      }
+      vKeys.swap(vKeysTmp);
+      vOrder.swap(vOrderTmp);
+    }
+  }
+
+  olc::rect m_rect; // dimensions of the whole tree
+  std::vector<LinearNode> m_nodes; // nodes in preorder, the root is always m_nodes[0]
+  std::vector<std::pair<olc::rect, Type>> m_items; // items sorted by cell, each subtree is one run
+};
+
+template<typename Type>
+class LinearQuadTreeContainer {
+  // Built once from everything inserted, so a vector is enough. The tree holds indices into
+  // it rather than iterators, as staging more items may reallocate it.
+  using QuadTreeContainer = std::vector<Type>;
+
+ public:
+  // Names an item in the container, search results are reported as these
+  using ItemId = uint32_t;
+
+ protected:
+  QuadTreeContainer m_allItems;
+  std::vector<olc::rect> m_allAreas;
+  LinearQuadTree<ItemId> root;
+
+ public:
+  LinearQuadTreeContainer(const olc::rect &size = {{0.0f, 0.0f}, {100.0f, 100.0f}}) : root(size) {}
+
+  // Sets the spatial coverage area of the quadtree
+  // Invalidates tree
+  void resize(const olc::rect &rArea) {
+    root.resize(rArea);
+  }
+
+  size_t size() const {
+    return m_allItems.size();
+  }
+
+  bool empty() const {
+    return m_allItems.empty();
+  }
+
+  void clear() {
+    root.clear();
+    m_allItems.clear();
+    m_allAreas.clear();
+  }
+
+  typename QuadTreeContainer::const_iterator begin() const {
+    return m_allItems.begin();
+  }
+
+  typename QuadTreeContainer::const_iterator end() const {
+    return m_allItems.end();
+  }
+
+  // The item named by an id from search()
+  const Type &operator[](ItemId id) const {
+    return m_allItems[id];
+  }
+
+  // Stages an item, it is not searchable until the next build()
+  void insert(const Type &item, const olc::rect &itemsize) {
+    m_allItems.push_back(item);
+    m_allAreas.push_back(itemsize);
+  }
+
+  // Replaces the contents with the given (item, area) pairs and builds the tree
+  void build(std::span<const std::pair<Type, olc::rect>> vItems) {
+    clear();
+    m_allItems.reserve(vItems.size());
+    m_allAreas.reserve(vItems.size());
+    for (auto const &p : vItems) insert(p.first, p.second);
+    build();
+  }
+
+  // Sorts everything inserted so far into the tree
+  void build() {
+    std::vector<std::pair<ItemId, olc::rect>> vItems;
+    vItems.reserve(m_allItems.size());
+    for (size_t i = 0; i < m_allItems.size(); i++) vItems.push_back({ItemId(i), m_allAreas[i]});
+    root.build(vItems);
+  }
+
+  // Returns a std::list of ids of items within the search area
+  [[nodiscard]] std::list<ItemId> search(const olc::rect &rArea) const {
+    std::list<ItemId> listItemIds;
+    root.search(rArea, listItemIds);
+    return listItemIds;
+  }
+
+  // Appends ids of items within the search area to a caller-owned vector
+  void search(const olc::rect &rArea, std::vector<ItemId> &vItemIds) const {
+    root.search(rArea, vItemIds);
+  }
+
+  // Calls fn(item) for each item within the search area, without building a list
+  template<typename Fn> requires std::invocable<Fn &, const Type &>
+  void search(const olc::rect &rArea, Fn &&fn) const {
+    root.search(rArea, [&](ItemId id) { fn(m_allItems[id]); });
+  }
+};
@@ -5,198 +5,7 @@
 #define OLC_PGEX_TRANSFORMEDVIEW
 #include "olcPGEX_TransformedView.h"
 
-namespace olc {
-struct rect {
-  olc::vf2d pos; // generic 2d float vector
-  olc::vf2d size;
-
-  rect(const olc::vf2d &p = {0.0f, 0.0f}, const olc::vf2d &s = {1.0f, 1.0f}) : pos(p), size(s) {}
-
-  [[nodiscard]] constexpr bool containsPoint(const olc::vf2d &p) const {
-    return !(p.x < pos.x || p.y < pos.y || p.x >= pos.x + size.x || p.y >= pos.y + size.y);
-  }
-
-  [[nodiscard]] constexpr bool containsRect(const olc::rect &r) const {
-    return (r.pos.x >= pos.x) && (r.pos.x + r.size.x < pos.x + size.x) && (r.pos.y >= pos.y)
-        && (r.pos.y + r.size.y < pos.y + size.y);
-  }
-
-  [[nodiscard]] constexpr bool overlaps(const olc::rect &r) const {
-    return (pos.x < r.pos.x + r.size.x && pos.x + size.x >= r.pos.x && pos.y < r.pos.y + r.size.y
-        && pos.y + size.y >= r.pos.y);
-  }
-};
-}
-
-constexpr size_t MAX_DEPTH = 8;
-
-template<typename Type>
-class StaticQuadTree {
- public:
-  StaticQuadTree( size_t nDepth = 0, const olc::rect &rArea = {{0.0f, 0.0f}, {100000.0f, 100000.0f}}) {
-    m_depth = nDepth;
-    resize(rArea);
-
-  }
-  void resize(const olc::rect &rArea) {
-    clear();
-    m_rect = rArea;
-    olc::vf2d vChildSize = m_rect.size / 2.0f;
-    m_rChild = {
-        olc::rect(m_rect.pos, vChildSize),
-        olc::rect({m_rect.pos.x + vChildSize.x, m_rect.pos.y}, vChildSize),
-        olc::rect({m_rect.pos.x, m_rect.pos.y + vChildSize.y}, vChildSize),
-        olc::rect({m_rect.pos.x + vChildSize.x, m_rect.pos.y + vChildSize.y}, vChildSize),
-    };
-  }
-
-  void clear() {
-    m_pItems.clear();
-    for (int i = 0; i < 4; i++) {
-      if (m_pChild[i]) m_pChild[i]->clear();
-      m_pChild[i].reset();
-    }
-  }
-
-  size_t size() const {
-    size_t nCount = m_pItems.size();
-    for (int i = 0; i < 4; i++) if (m_pChild[i]) nCount += m_pChild[i]->size();
-    return nCount;
-  }
-
- public:
-
-  void insert(const Type &item, const olc::rect &item_size) {
-    for (int i = 0; i < 4; i++) {
-      if (m_rChild[i].containsRect(item_size)) {
-        if (m_depth + 1 < MAX_DEPTH) {
-          if (!m_pChild[i]) {
-            m_pChild[i] = std::make_shared<StaticQuadTree<Type>>(m_depth + 1, m_rChild[i]);
-          }
-
-          m_pChild[i]->insert(item, item_size);
-          return;
-        }
-      }
-    }
-    m_pItems.push_back({item_size, item});
-  }
-
-  [[nodiscard]] std::list<Type> search(const olc::rect &search_area) const {
-    std::list<Type> itemsInside;
-    search(search_area, itemsInside);
-    return itemsInside;
-  }
-// Returns the objects in the given search area, by adding to supplied list
-  void search(const olc::rect &rArea, std::list<Type> &listItems) const {
-    for (auto const &p : m_pItems) {
-      if (rArea.overlaps(p.first)) listItems.push_back(p.second);
-    }
-
-    for (int i = 0; i < 4; i++) {
-      if (m_pChild[i]) {
-
-        if (rArea.containsRect(m_rChild[i])) {
-          m_pChild[i]->items(listItems);
-        }
-
-        if (rArea.overlaps(m_rChild[i])) {
-          m_pChild[i]->search(rArea, listItems);
-        }
-      }
-    }
-  }
-
-  void items(std::list<Type> &listItem) const {
-    for (auto const &p : m_pItems) listItem.push_back(p.second);
-
-    for (int i = 0; i < 4; i++) if (m_pChild[i]) m_pChild[i]->items(listItem);
-  }
-
-  const olc::rect &area() { return m_rect; }
-
- protected:
-  size_t m_depth = 0;
-  olc::rect m_rect; // dimensions of the current quadTreeSection
-  std::array<olc::rect, 4> m_rChild{}; // dimensions of the children quadTree
-  std::array<std::shared_ptr<StaticQuadTree<Type>>, 4> m_pChild{}; // sub QuadTrees in each subsection
-  std::vector<std::pair<olc::rect, Type>> m_pItems;
-};
-template<typename Type>
-class StaticQuadTreeContainer {
-  // Using a std::list as we dont want pointers to be invalidated to objects stored in the
-  // tree should the contents of the tree change
-  using QuadTreeContainer = std::list<Type>;
-
- protected:
-  // The actual container
-  QuadTreeContainer m_allItems;
-
-  // Use our StaticQuadTree to store "pointers" instead of objects - this reduces
-  // overheads when moving or copying objects
-  StaticQuadTree<typename QuadTreeContainer::iterator> root;
-
- public:
-  StaticQuadTreeContainer(const olc::rect &size = {{0.0f, 0.0f}, {100.0f, 100.0f}}, const size_t nDepth = 0)
-      : root(nDepth, size) {
-
-  }
-
-  // Sets the spatial coverage area of the quadtree
-  // Invalidates tree
-  void resize(const olc::rect &rArea) {
-    root.resize(rArea);
-  }
-
-  // Returns number of items within tree
-  size_t size() const {
-    return m_allItems.size();
-  }
-
-  // Returns true if tree is empty
-  bool empty() const {
-    return m_allItems.empty();
-  }
-
-  // Removes all items from tree
-  void clear() {
-    root.clear();
-    m_allItems.clear();
-  }
-
-  // Convenience functions for ranged for loop
-  typename QuadTreeContainer::iterator begin() {
-    return m_allItems.begin();
-  }
-
-  typename QuadTreeContainer::iterator end() {
-    return m_allItems.end();
-  }
-
-  typename QuadTreeContainer::const_iterator cbegin() {
-    return m_allItems.cbegin();
-  }
-
-  typename QuadTreeContainer::const_iterator cend() {
-    return m_allItems.cend();
-  }
-
-  void insert(const Type &item, const olc::rect &itemsize) {
-    // Item is stored in container
-    m_allItems.push_back(item);
-
-    // Pointer/Area of item is stored in quad tree
-    root.insert(std::prev(m_allItems.end()), itemsize);
-  }
-
-  // Returns a std::list of pointers to items within the search area
-  [[nodiscard]] std::list<typename QuadTreeContainer::iterator> search(const olc::rect &rArea) const {
-    std::list<typename QuadTreeContainer::iterator> listItemPointers;
-    root.search(rArea, listItemPointers);
-    return listItemPointers;
-  }
-
-};
+#include "QuadTree.h"
 
 class Example_StaticQuadTree : public olc::PixelGameEngine {
  public:
@@ -214,8 +23,30 @@ class Example_StaticQuadTree : public olc::PixelGameEngine {
     olc::Pixel colour;
   };
 
+  // Colour totals kept per quadtree node, so a node too small to see can be drawn as one
+  // rect of its average colour
+  struct ColourSum {
+    uint64_t r = 0, g = 0, b = 0;
+    void add(const Object2d &ob) {
+      r += ob.colour.r;
+      g += ob.colour.g;
+      b += ob.colour.b;
+    }
+    void remove(const Object2d &ob) {
+      r -= ob.colour.r;
+      g -= ob.colour.g;
+      b -= ob.colour.b;
+    }
+    void add(const ColourSum &other) {
+      r += other.r;
+      g += other.g;
+      b += other.b;
+    }
+  };
+
   std::vector<Object2d> vecObjects;
-  StaticQuadTreeContainer<Object2d> treeObjects;
+  StaticQuadTreeContainer<Object2d, ColourSum> treeObjects;
+  LinearQuadTreeContainer<Object2d> linearTreeObjects;
 
   float fArea = 100'000.0f;
 
@@ -240,16 +71,50 @@ class Example_StaticQuadTree : public olc::PixelGameEngine {
   }
   uint32_t seed = 124124124;
 
-  bool bUseQuadTree = true;
+  enum class SearchMode { QuadTree, LinearQuadTree, Linear };
+  SearchMode mode = SearchMode::QuadTree;
+  bool bUseLod = false;
+  bool bParallel = false;
+  std::vector<StaticQuadTreeContainer<Object2d, ColourSum>::ItemId> vVisible;
+
+  // Cells of the LOD search, painted one pixel per cell into a sprite drawn as a single decal
+  StaticQuadTreeContainer<Object2d, ColourSum>::LodCells lodCells;
+  std::unique_ptr<olc::Sprite> sprLod;
+  std::unique_ptr<olc::Decal> decLod;
+
+  // Draws every cell the last LOD search pooled objects into in their average colour, returning
+  // how many objects the cells hold
+  size_t DrawLodCells(float fCellSize) {
+    if (lodCells.width() == 0) return 0;
+    if (!sprLod || sprLod->width != int32_t(lodCells.width()) || sprLod->height != int32_t(lodCells.height())) {
+      sprLod = std::make_unique<olc::Sprite>(lodCells.width(), lodCells.height());
+      decLod = std::make_unique<olc::Decal>(sprLod.get());
+    }
+    std::fill(sprLod->pColData.begin(), sprLod->pColData.end(), olc::BLANK);
+
+    size_t nCount = 0;
+    lodCells.for_each([&](uint32_t x, uint32_t y, size_t n, const ColourSum &sum) {
+      sprLod->pColData[size_t(y) * sprLod->width + x] = olc::Pixel(uint8_t(sum.r / n), uint8_t(sum.g / n),
+                                                                   uint8_t(sum.b / n));
+      nCount += n;
+    });
+    decLod->Update();
+    tv.DrawDecal(lodCells.cell(0, 0).pos, decLod.get(), {fCellSize, fCellSize});
+    return nCount;
+  }
  public:
   bool OnUserCreate() override {
     tv.Initialise({ScreenWidth(), ScreenHeight()});
     treeObjects.resize(olc::rect({0.0f, 0.0f}, {fArea, fArea}));
+    treeObjects.set_config({.nMaxDepth = 12, .nLeafCapacity = 32, .fLooseness = 2.0f});
+    linearTreeObjects.resize(olc::rect({0.0f, 0.0f}, {fArea, fArea}));
 
     auto rand_float = [this](const float l, const float r) {
       return Example_StaticQuadTree::RandomFloat(this->seed) * (r - l) + l;
     };
 
+    std::vector<std::pair<Object2d, olc::rect>> vItems;
+    vItems.reserve(1'000'000);
     for (int i = 0; i < 1'000'000; i++) {
       Object2d ob;
       ob.vPos = {rand_float(0.0f, fArea), rand_float(0.0f, fArea)};
@@ -261,32 +126,73 @@ class Example_StaticQuadTree : public olc::PixelGameEngine {
                                  0.0f,
                                  256)));
       vecObjects.push_back(ob);
-      treeObjects.insert(ob, olc::rect(ob.vPos, ob.vSize));
+      vItems.push_back({ob, olc::rect(ob.vPos, ob.vSize)});
 
     }
+    treeObjects.build(vItems);
+    linearTreeObjects.build(vItems);
 
     return true;
   }
   bool OnUserUpdate(float fElapsedTime) override {
     if (GetKey(olc::Key::TAB).bPressed)
-      bUseQuadTree = !bUseQuadTree;
+      mode = SearchMode((int(mode) + 1) % 3);
+    if (GetKey(olc::Key::L).bPressed)
+      bUseLod = !bUseLod;
+    if (GetKey(olc::Key::P).bPressed)
+      bParallel = !bParallel;
     tv.HandlePanAndZoom(0);
     olc::rect rScreen = {tv.GetWorldTL(), tv.GetWorldBR() - tv.GetWorldTL()};
     size_t nObjectCount = 0;
 
-    if (bUseQuadTree) {
+    if (mode == SearchMode::QuadTree) {
 
       auto tpStart = std::chrono::system_clock::now();
-      for (auto const &ob : treeObjects.search(rScreen)) {
-        tv.FillRectDecal(ob->vPos, ob->vSize, ob->colour);
+      auto draw = [&](const Object2d &ob) {
+        tv.FillRectDecal(ob.vPos, ob.vSize, ob.colour);
         nObjectCount++;
+      };
+      if (bUseLod) {
+        // Objects smaller than a pixel are pooled per pixel, drawn in their average colour
+        const float fPixel = tv.ScaleToWorld({1.0f, 1.0f}).x;
+        treeObjects.lod_search(rScreen, fPixel, lodCells, draw);
+        nObjectCount += DrawLodCells(fPixel);
+      } else if (bParallel) {
+        // Decals must be drawn from this thread, so only the search itself is spread out
+        vVisible.clear();
+        treeObjects.search_parallel(rScreen, vVisible);
+        for (auto id : vVisible) draw(treeObjects[id]);
+      } else {
+        treeObjects.search(rScreen, draw);
       }
+
+      // Outline whatever is under the mouse
+      if (const Object2d *pPicked = treeObjects.query_point(tv.ScreenToWorld(GetMousePos())))
+        tv.DrawRectDecal(pPicked->vPos, pPicked->vSize, olc::WHITE);
       std::chrono::duration<float> duration = std::chrono::system_clock::now() - tpStart;
-      std::string
-          sOutput = "QuadTree " + std::to_string(nObjectCount) + "/" + std::to_string(vecObjects.size()) + " in "
+      const char *sLabel = "QuadTree ";
+      if (bUseLod) {
+        sLabel = "QuadTree (LOD) ";
+      } else if (bParallel) {
+        sLabel = "QuadTree (parallel) ";
+      }
+      std::string sOutput = sLabel + std::to_string(nObjectCount) + "/" + std::to_string(vecObjects.size()) + " in "
           + std::to_string(duration.count());
       DrawStringDecal({4, 4}, sOutput, olc::BLACK, {2.0f, 4.0f});
       DrawStringDecal({2, 2}, sOutput, olc::WHITE, {2.0f, 4.0f});
+    } else if (mode == SearchMode::LinearQuadTree) {
+
+      auto tpStart = std::chrono::system_clock::now();
+      linearTreeObjects.search(rScreen, [&](const Object2d &ob) {
+        tv.FillRectDecal(ob.vPos, ob.vSize, ob.colour);
+        nObjectCount++;
+      });
+      std::chrono::duration<float> duration = std::chrono::system_clock::now() - tpStart;
+      std::string
+          sOutput = "Linear QuadTree " + std::to_string(nObjectCount) + "/" + std::to_string(vecObjects.size())
+          + " in " + std::to_string(duration.count());
+      DrawStringDecal({4, 4}, sOutput, olc::BLACK, {2.0f, 4.0f});
+      DrawStringDecal({2, 2}, sOutput, olc::WHITE, {2.0f, 4.0f});
     } else {
 
       auto tpStart = std::chrono::system_clock::now();
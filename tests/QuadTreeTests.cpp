@@ -0,0 +1,676 @@
+// Checks the quadtrees in QuadTree.h against brute force searches over random items, and
+// checks the tree's internal bookkeeping after every kind of edit
+#define OLC_PGE_APPLICATION
+#include "olcPixelGameEngine.h"
+
+#include "QuadTree.h"
+
+#include <cstdio>
+#include <map>
+#include <random>
+
+static int nFailures = 0;
+
+#define CHECK(cond)                                                              \
+  do {                                                                           \
+    if (!(cond)) {                                                               \
+      std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+      nFailures++;                                                               \
+    }                                                                            \
+  } while (0)
+
+constexpr float AREA = 10000.0f;
+const olc::rect rWorld = {{0.0f, 0.0f}, {AREA, AREA}};
+
+struct Item {
+  olc::rect rArea;
+  int nId;
+};
+
+static std::vector<Item> random_items(size_t nCount, float fArea, uint32_t nSeed) {
+  std::mt19937 rng(nSeed);
+  std::uniform_real_distribution<float> pos(0.0f, fArea), size(0.1f, 100.0f);
+  std::vector<Item> vItems;
+  for (size_t i = 0; i < nCount; i++) vItems.push_back({{{pos(rng), pos(rng)}, {size(rng), size(rng)}}, int(i)});
+  return vItems;
+}
+
+static std::vector<std::pair<int, olc::rect>> id_pairs(const std::vector<Item> &vItems) {
+  std::vector<std::pair<int, olc::rect>> vPairs;
+  for (auto const &item : vItems) vPairs.push_back({item.nId, item.rArea});
+  return vPairs;
+}
+
+template<typename Range>
+static std::vector<int> sorted(const Range &range) {
+  std::vector<int> v(range.begin(), range.end());
+  std::sort(v.begin(), v.end());
+  return v;
+}
+
+// Ids of the items overlapping rArea, by testing every one
+static std::vector<int> brute_search(const std::vector<Item> &vItems, const olc::rect &rArea) {
+  std::vector<int> vIds;
+  for (auto const &item : vItems) if (rArea.overlaps(item.rArea)) vIds.push_back(item.nId);
+  std::sort(vIds.begin(), vIds.end());
+  return vIds;
+}
+
+static bool touches(const olc::rect &a, const olc::rect &b) {
+  return a.pos.x <= b.pos.x + b.size.x && b.pos.x <= a.pos.x + a.size.x && a.pos.y <= b.pos.y + b.size.y
+      && b.pos.y <= a.pos.y + a.size.y;
+}
+
+static float distance2(const olc::vf2d &p, const olc::rect &r) {
+  const float dx = std::max({r.pos.x - p.x, 0.0f, p.x - (r.pos.x + r.size.x)});
+  const float dy = std::max({r.pos.y - p.y, 0.0f, p.y - (r.pos.y + r.size.y)});
+  return dx * dx + dy * dy;
+}
+
+// Search areas of all sizes, some sticking out of the tree's area
+struct RandomQueries {
+  std::mt19937 rng{7};
+  std::uniform_real_distribution<float> pos{-500.0f, AREA}, size{1.0f, 5000.0f};
+
+  olc::rect operator()() { return {{pos(rng), pos(rng)}, {size(rng), size(rng)}}; }
+  olc::vf2d point() { return {pos(rng), pos(rng)}; }
+};
+
+// Walks a tree's nodes checking the cached counts, every item's recorded location and every
+// child's parent
+template<typename Type>
+struct TreeInspector : StaticQuadTree<Type> {
+  using Tree = StaticQuadTree<Type>;
+
+  size_t validate(uint32_t n) const {
+    const auto &node = this->m_nodes[n];
+    size_t nCount = node.items.size();
+    for (size_t k = 0; k < node.items.size(); k++) {
+      const auto &loc = this->m_locations[node.items.vHandle[k]];
+      CHECK(loc.nNode == n && loc.nSlot == k);
+    }
+    for (uint32_t c : node.nChild) {
+      if (c == Tree::NONE) continue;
+      CHECK(this->m_nodes[c].nParent == n);
+      nCount += validate(c);
+    }
+    CHECK(nCount == node.nCount);
+    return nCount;
+  }
+};
+
+template<typename Type>
+static void validate(const StaticQuadTree<Type> &tree) {
+  static_cast<const TreeInspector<Type> &>(tree).validate(0);
+}
+
+static void test_search() {
+  const auto vItems = random_items(50000, AREA, 1);
+  const auto vPairs = id_pairs(vItems);
+  RandomQueries query;
+
+  for (QuadTreeConfig config : {QuadTreeConfig{}, QuadTreeConfig{8, 16}, QuadTreeConfig{12, 64, 50.0f},
+                                QuadTreeConfig{3, 4}, QuadTreeConfig{8, 0, 0.0f, 2.0f},
+                                QuadTreeConfig{12, 16, 0.0f, 1.5f}}) {
+    StaticQuadTree<int> inserted(0, rWorld, config), built(0, rWorld, config);
+    for (auto const &item : vItems) inserted.insert(item.nId, item.rArea);
+    built.build(vPairs);
+    CHECK(inserted.size() == vItems.size() && built.size() == vItems.size());
+    validate(inserted);
+    validate(built);
+
+    for (int k = 0; k < 50; k++) {
+      const olc::rect rArea = query();
+      const auto vWant = brute_search(vItems, rArea);
+      CHECK(sorted(inserted.search(rArea)) == vWant);
+      CHECK(sorted(built.search(rArea)) == vWant);
+      CHECK(built.count(rArea) == vWant.size());
+
+      std::vector<int> vAppended;
+      built.search(rArea, vAppended);
+      std::vector<int> vLazy;
+      for (int n : built.search_range(rArea)) vLazy.push_back(n);
+      CHECK(vLazy == vAppended);
+      size_t nFirst = 0;
+      for (int n : built.search_range(rArea) | std::views::take(5)) nFirst += (n >= 0);
+      CHECK(nFirst == std::min<size_t>(5, vWant.size()));
+    }
+
+    // Restructure both trees in place
+    inserted.set_config({10, 1000});
+    built.set_config({6, 0, 0.0f, config.fLooseness > 1.0f ? 1.0f : 2.0f});
+    validate(inserted);
+    validate(built);
+    for (int k = 0; k < 50; k++) {
+      const olc::rect rArea = query();
+      const auto vWant = brute_search(vItems, rArea);
+      CHECK(sorted(inserted.search(rArea)) == vWant);
+      CHECK(sorted(built.search(rArea)) == vWant);
+    }
+  }
+}
+
+static void test_linear() {
+  auto vItems = random_items(50000, AREA, 1);
+  vItems.push_back({{{-50.0f, -50.0f}, {20.0f, 20.0f}}, -1}); // outside the tree's area
+  RandomQueries query;
+
+  LinearQuadTree<int> tree(rWorld);
+  tree.build(id_pairs(vItems));
+  CHECK(tree.size() == vItems.size());
+  for (int k = 0; k < 100; k++) {
+    const olc::rect rArea = k == 0 ? olc::rect({-100.0f, -100.0f}, {2 * AREA, 2 * AREA}) : query();
+    CHECK(sorted(tree.search(rArea)) == brute_search(vItems, rArea));
+  }
+
+  // Staging more items after a build must not disturb the built tree
+  LinearQuadTreeContainer<int> container(rWorld);
+  container.insert(1, {{10.0f, 10.0f}, {5.0f, 5.0f}});
+  container.build();
+  for (int k = 0; k < 1000; k++) container.insert(100 + k, {{20.0f, 20.0f}, {5.0f, 5.0f}});
+  std::vector<int> vFound;
+  container.search({{0.0f, 0.0f}, {50.0f, 50.0f}}, [&](const int &n) { vFound.push_back(n); });
+  CHECK(vFound == std::vector<int>{1});
+  container.build();
+  std::vector<uint32_t> vIds;
+  container.search({{0.0f, 0.0f}, {50.0f, 50.0f}}, vIds);
+  CHECK(vIds.size() == 1001);
+  vIds.clear();
+  container.search({{0.0f, 0.0f}, {15.0f, 15.0f}}, vIds);
+  CHECK(vIds.size() == 1 && container[vIds[0]] == 1);
+}
+
+// Trees big enough for build() to make subtrees on other threads, which are then spliced in
+static void test_parallel_build() {
+  const auto vItems = random_items(400000, AREA, 3);
+  const auto vPairs = id_pairs(vItems);
+  RandomQueries query;
+
+  for (QuadTreeConfig config : {QuadTreeConfig{}, QuadTreeConfig{12, 32, 0.0f, 2.0f}}) {
+    StaticQuadTree<int> tree(0, rWorld, config);
+    tree.build(vPairs);
+    validate(tree);
+    for (int k = 0; k < 20; k++) {
+      const olc::rect rArea = query();
+      CHECK(sorted(tree.search(rArea)) == brute_search(vItems, rArea));
+    }
+
+    // Removing and moving walk up the spliced subtrees' parents
+    for (uint32_t h = 0; h < vItems.size(); h += 37) tree.remove(h);
+    for (uint32_t h = 1; h < vItems.size(); h += 37)
+      tree.relocate(h, {{float(h % 9000), float(h % 7000)}, {3.0f, 3.0f}});
+    validate(tree);
+  }
+}
+
+// Random inserts, removes and moves, checked against a model of what the tree should hold
+static void test_edits() {
+  RandomQueries query;
+  for (QuadTreeConfig config : {QuadTreeConfig{}, QuadTreeConfig{8, 16}, QuadTreeConfig{10, 8, 0.0f, 2.0f},
+                                QuadTreeConfig{8, 4}}) {
+    std::mt19937 rng(11);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    const auto vItems = random_items(5000, AREA, 5);
+
+    StaticQuadTree<int> tree(0, rWorld, config);
+    tree.build(id_pairs(vItems));
+    std::map<uint32_t, Item> model;
+    for (auto const &item : vItems) model[item.nId] = item;
+
+    int nNextId = 100000;
+    for (int nStep = 0; nStep < 20000; nStep++) {
+      const float fAction = unit(rng);
+      auto pick = [&]() {
+        auto it = model.lower_bound(rng() % 110000);
+        return it == model.end() ? model.begin() : it;
+      };
+      if (fAction < 0.3f && !model.empty()) {
+        auto it = pick();
+        CHECK(tree.get(it->first) == it->second.nId);
+        tree.remove(it->first);
+        model.erase(it);
+      } else if (fAction < 0.6f) {
+        const Item item = {{{unit(rng) * AREA, unit(rng) * AREA}, {unit(rng) * 100, unit(rng) * 100}}, nNextId++};
+        const auto h = tree.insert(item.nId, item.rArea);
+        CHECK(!model.count(h));
+        model[h] = item;
+      } else if (!model.empty()) {
+        auto it = pick();
+        olc::rect rArea = it->second.rArea;
+        if (unit(rng) < 0.5f) {
+          rArea.pos += olc::vf2d(unit(rng) * 20 - 10, unit(rng) * 20 - 10);
+        } else {
+          rArea.pos = {unit(rng) * AREA * 1.1f - 50, unit(rng) * AREA};
+        }
+        tree.relocate(it->first, rArea);
+        it->second.rArea = rArea;
+      }
+
+      if (nStep % 2000 == 0) {
+        validate(tree);
+        std::vector<Item> vLive;
+        for (auto const &[h, item] : model) vLive.push_back(item);
+        CHECK(tree.size() == vLive.size());
+        for (int k = 0; k < 20; k++) {
+          const olc::rect rArea = query();
+          const auto vWant = brute_search(vLive, rArea);
+          CHECK(sorted(tree.search(rArea)) == vWant);
+          CHECK(tree.count(rArea) == vWant.size());
+        }
+      }
+    }
+  }
+}
+
+static void test_update_all() {
+  RandomQueries query;
+  for (QuadTreeConfig config : {QuadTreeConfig{}, QuadTreeConfig{8, 16}, QuadTreeConfig{10, 8, 0.0f, 2.0f}}) {
+    std::mt19937 rng(13);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    auto vItems = random_items(20000, AREA, 9);
+    StaticQuadTree<int> tree(0, rWorld, config);
+    tree.build(id_pairs(vItems));
+
+    for (int nFrame = 0; nFrame < 20; nFrame++) {
+      // Some items move more than once in a frame, the last move wins
+      std::vector<std::pair<uint32_t, olc::rect>> vMoves;
+      for (int k = 0; k < 3000; k++) {
+        const uint32_t h = rng() % vItems.size();
+        olc::rect rArea = vItems[h].rArea;
+        if (unit(rng) < 0.8f) {
+          rArea.pos += olc::vf2d(unit(rng) * 200 - 100, unit(rng) * 200 - 100);
+        } else {
+          rArea.pos = {unit(rng) * AREA, unit(rng) * AREA};
+        }
+        vItems[h].rArea = rArea;
+        vMoves.push_back({h, rArea});
+      }
+      tree.update_all(vMoves);
+      validate(tree);
+      for (int k = 0; k < 10; k++) {
+        const olc::rect rArea = query();
+        CHECK(sorted(tree.search(rArea)) == brute_search(vItems, rArea));
+      }
+    }
+  }
+}
+
+static void test_container() {
+  const auto vItems = random_items(50000, AREA, 1);
+  RandomQueries query;
+
+  StaticQuadTreeContainer<int> built(id_pairs(vItems), rWorld, 0, {8, 8, 0.0f, 2.0f});
+  CHECK(built.size() == vItems.size());
+  for (int k = 0; k < 50; k++) {
+    const olc::rect rArea = query();
+    const auto vWant = brute_search(vItems, rArea);
+    std::vector<int> vFound;
+    built.search(rArea, [&](int &n) { vFound.push_back(n); });
+    CHECK(sorted(vFound) == vWant);
+    std::vector<uint32_t> vIds;
+    built.search(rArea, vIds);
+    CHECK(vIds.size() == vWant.size());
+    vFound.clear();
+    for (int &n : built.search_range(rArea)) vFound.push_back(n);
+    CHECK(sorted(vFound) == vWant);
+    CHECK(built.count(rArea) == vWant.size());
+  }
+
+  StaticQuadTreeContainer<int> container(rWorld, 0, {8, 4});
+  const auto h1 = container.insert(1, {{10.0f, 10.0f}, {5.0f, 5.0f}});
+  const auto h2 = container.insert(2, {{20.0f, 10.0f}, {5.0f, 5.0f}});
+  container.relocate(h1, {{5000.0f, 5000.0f}, {5.0f, 5.0f}});
+  CHECK(container.search({{4990.0f, 4990.0f}, {30.0f, 30.0f}}).size() == 1);
+  container.remove(h2);
+  CHECK(container.size() == 1 && *container.begin() == 1);
+  container.insert(3, {{30.0f, 10.0f}, {5.0f, 5.0f}});
+  std::vector<int> vAll;
+  for (int n : container) vAll.push_back(n);
+  CHECK(vAll == std::vector<int>({1, 3}));
+  // Ids reported by a search name the items for relocate() and remove()
+  std::vector<uint32_t> vHits;
+  container.search({{4990.0f, 4990.0f}, {30.0f, 30.0f}}, vHits);
+  CHECK(vHits.size() == 1 && container[vHits[0]] == 1);
+  container.relocate(vHits[0], {{7000.0f, 7000.0f}, {5.0f, 5.0f}});
+  CHECK(container.count({{6990.0f, 6990.0f}, {30.0f, 30.0f}}) == 1);
+  container.remove(vHits[0]);
+  CHECK(container.size() == 1 && container.count(rWorld) == 1);
+  for (int k = 0; k < 3000; k++) container.insert(k, {{float(k), 1.0f}, {1.0f, 1.0f}});
+  CHECK(container.size() == 3001 && container.count(rWorld) == 3001);
+}
+
+static void test_lod() {
+  const auto vItems = random_items(50000, AREA, 1);
+  const olc::rect rArea = {{-100.0f, -100.0f}, {AREA + 200.0f, AREA + 200.0f}};
+
+  for (QuadTreeConfig config : {QuadTreeConfig{}, QuadTreeConfig{12, 32, 0.0f, 2.0f}}) {
+    StaticQuadTree<int> tree(0, rWorld, config);
+    tree.build(id_pairs(vItems));
+    // One grid reused across searches of different cell sizes
+    LodGrid<NoAggregate> cells;
+    for (float fCell : {10.0f, 150.0f, 1000.0f, 10.0f}) {
+      size_t nItems = 0, nCells = 0, nPooled = 0;
+      tree.lod_search(rArea, fCell, cells, [&](int) { nItems++; });
+      cells.for_each([&](uint32_t x, uint32_t y, size_t nCount, const NoAggregate &) {
+        CHECK(x < cells.width() && y < cells.height() && cells.cell(x, y).size.x == fCell && nCount > 0);
+        nCells++;
+        nPooled += nCount;
+      });
+      CHECK(nCells == cells.size());
+      const size_t nMaxCells = size_t(std::ceil(rArea.size.x / fCell) + 1)
+          * size_t(std::ceil(rArea.size.y / fCell) + 1);
+      CHECK(nItems + nPooled == vItems.size());
+      CHECK(nCells > 0 && nCells <= nMaxCells);
+      // Every item is under 100 wide, so cells that size and up pool all of them
+      if (fCell >= 150.0f) CHECK(nItems == 0);
+    }
+  }
+
+  // Aggregates follow removes and moves
+  struct Sum {
+    long long nTotal = 0;
+    void add(const Item &item) { nTotal += item.nId; }
+    void remove(const Item &item) { nTotal -= item.nId; }
+    void add(const Sum &other) { nTotal += other.nTotal; }
+  };
+  std::vector<std::pair<Item, olc::rect>> vPairs;
+  for (auto const &item : vItems) vPairs.push_back({item, item.rArea});
+  StaticQuadTreeContainer<Item, Sum> container(vPairs, rWorld, 0, {10, 8, 0.0f, 2.0f});
+  std::vector<StaticQuadTreeContainer<Item, Sum>::ItemId> vHandles;
+  for (size_t i = 0; i < 1000; i++) {
+    const Item item = {{{5.0f, 5.0f}, {1.0f, 1.0f}}, 100000 + int(i)};
+    vHandles.push_back(container.insert(item, {{float(i) * 9, 5.0f}, {1.0f, 1.0f}}));
+  }
+  for (size_t i = 0; i < 500; i++) container.remove(vHandles[i]);
+  for (size_t i = 500; i < 1000; i++) container.relocate(vHandles[i], {{float(i) * 3, 9000.0f}, {2.0f, 2.0f}});
+
+  long long nTotal = 0, nWant = 0;
+  size_t nCount = 0;
+  StaticQuadTreeContainer<Item, Sum>::LodCells cells;
+  container.lod_search({{-1000.0f, -1000.0f}, {AREA + 2000.0f, AREA + 2000.0f}}, 500.0f, cells,
+                       [&](Item &item) { nTotal += item.nId; nCount++; });
+  cells.for_each([&](uint32_t, uint32_t, size_t n, const Sum &sum) { nTotal += sum.nTotal; nCount += n; });
+  for (auto const &item : vItems) nWant += item.nId;
+  for (size_t i = 500; i < 1000; i++) nWant += 100000 + int(i);
+  CHECK(nCount == vItems.size() + 500 && nTotal == nWant);
+}
+
+// Picking, nearest neighbours, circles and rays
+static void test_point_queries() {
+  const auto vItems = random_items(50000, AREA, 1);
+  const auto vPairs = id_pairs(vItems);
+  RandomQueries query;
+
+  for (QuadTreeConfig config : {QuadTreeConfig{}, QuadTreeConfig{10, 8, 0.0f, 2.0f}, QuadTreeConfig{8, 4}}) {
+    StaticQuadTree<int> tree(0, rWorld, config);
+    tree.build(vPairs);
+    StaticQuadTreeContainer<int> container(vPairs, rWorld, 0, config);
+
+    for (int k = 0; k < 1000; k++) {
+      const olc::vf2d p = k % 10 == 0 ? vItems[k].rArea.pos : query.point();
+      std::vector<int> vWant;
+      for (auto const &item : vItems) if (item.rArea.containsPoint(p)) vWant.push_back(item.nId);
+      std::sort(vWant.begin(), vWant.end());
+
+      std::vector<int> vFound;
+      tree.query_point(p, [&](int n) { vFound.push_back(n); });
+      CHECK(sorted(vFound) == vWant);
+      const int *pFirst = tree.query_point(p);
+      CHECK(vWant.empty() ? !pFirst : std::binary_search(vWant.begin(), vWant.end(), *pFirst));
+      const int *pPicked = container.query_point(p);
+      CHECK(vWant.empty() ? !pPicked : std::binary_search(vWant.begin(), vWant.end(), *pPicked));
+      if (k % 10 != 0) continue;
+
+      // Distances to every item, so the nearest k can be checked by distance
+      std::vector<float> vDist;
+      std::map<int, float> distById;
+      for (auto const &item : vItems) {
+        vDist.push_back(distance2(p, item.rArea));
+        distById[item.nId] = vDist.back();
+      }
+      std::sort(vDist.begin(), vDist.end());
+      const size_t nNearest = (k / 10) % 3 == 0 ? 1 : (k / 10) % 3 == 1 ? 7 : 40;
+      const auto vNearest = tree.nearest(p, nNearest);
+      CHECK(vNearest.size() == nNearest);
+      for (size_t j = 0; j < vNearest.size(); j++) CHECK(distById[vNearest[j]] == vDist[j]);
+      const auto vNearestIds = container.nearest(p, nNearest);
+      CHECK(vNearestIds.size() == nNearest && distById[container[vNearestIds.back()]] == vDist[nNearest - 1]);
+
+      const float fRadius = (k / 10) % 4 == 0 ? 0.0f : query.size(query.rng) / 3;
+      vWant.clear();
+      for (auto const &item : vItems) if (distance2(p, item.rArea) <= fRadius * fRadius) vWant.push_back(item.nId);
+      std::sort(vWant.begin(), vWant.end());
+      vFound.clear();
+      tree.search_circle(p, fRadius, [&](int n) { vFound.push_back(n); });
+      CHECK(sorted(vFound) == vWant);
+
+      olc::vf2d vDir = query.point() - p;
+      if (k % 30 == 0) vDir.x = 0.0f;
+      if (k % 50 == 0) vDir.y = 0.0f;
+      const float fMaxT = k % 20 == 0 ? 0.5f : 1.0f;
+      auto entry = [&](const olc::rect &r) {
+        float tNear = 0.0f, tFar = fMaxT;
+        auto slab = [&](float o, float d, float fMin, float fMax) {
+          if (d == 0.0f) {
+            if (o < fMin || o > fMax) tFar = -1.0f;
+            return;
+          }
+          float t0 = (fMin - o) / d, t1 = (fMax - o) / d;
+          if (t0 > t1) std::swap(t0, t1);
+          tNear = std::max(tNear, t0);
+          tFar = std::min(tFar, t1);
+        };
+        slab(p.x, vDir.x, r.pos.x, r.pos.x + r.size.x);
+        slab(p.y, vDir.y, r.pos.y, r.pos.y + r.size.y);
+        return tNear <= tFar ? tNear : -1.0f;
+      };
+      vWant.clear();
+      float fFirst = std::numeric_limits<float>::infinity();
+      for (auto const &item : vItems) {
+        const float t = entry(item.rArea);
+        if (t < 0.0f) continue;
+        vWant.push_back(item.nId);
+        fFirst = std::min(fFirst, t);
+      }
+      std::sort(vWant.begin(), vWant.end());
+      vFound.clear();
+      tree.raycast(p, vDir, fMaxT, [&](int n, float t) {
+        CHECK(t >= 0.0f && t <= fMaxT);
+        vFound.push_back(n);
+      });
+      CHECK(sorted(vFound) == vWant);
+      const auto hit = tree.raycast(p, vDir, fMaxT);
+      CHECK(bool(hit) == !vWant.empty() && (!hit || hit->second == fFirst));
+      const auto hitId = container.raycast(p, vDir, fMaxT);
+      CHECK(bool(hitId) == !vWant.empty() && (!hitId || hitId->second == fFirst));
+    }
+  }
+}
+
+static void test_polygon() {
+  const auto vItems = random_items(50000, AREA, 1);
+  const auto vPairs = id_pairs(vItems);
+  RandomQueries query;
+  StaticQuadTree<int> tree(0, rWorld, {10, 8, 0.0f, 1.5f});
+  tree.build(vPairs);
+  StaticQuadTreeContainer<int> container(vPairs, rWorld, 0, {8, 8});
+
+  // Separating axes of both shapes, worked out independently of the tree
+  auto overlaps = [](const std::vector<olc::vf2d> &vPolygon, const olc::rect &r) {
+    const std::vector<olc::vf2d> vBox = {r.pos, {r.pos.x + r.size.x, r.pos.y}, r.pos + r.size,
+                                         {r.pos.x, r.pos.y + r.size.y}};
+    std::vector<olc::vf2d> vAxes = {{1.0f, 0.0f}, {0.0f, 1.0f}};
+    for (size_t i = 0; i < vPolygon.size(); i++) {
+      const olc::vf2d a = vPolygon[i], b = vPolygon[(i + 1) % vPolygon.size()];
+      vAxes.push_back({b.y - a.y, a.x - b.x});
+    }
+    for (auto const &vAxis : vAxes) {
+      float fMinA = INFINITY, fMaxA = -INFINITY, fMinB = INFINITY, fMaxB = -INFINITY;
+      for (auto const &v : vPolygon) {
+        fMinA = std::min(fMinA, vAxis.dot(v));
+        fMaxA = std::max(fMaxA, vAxis.dot(v));
+      }
+      for (auto const &v : vBox) {
+        fMinB = std::min(fMinB, vAxis.dot(v));
+        fMaxB = std::max(fMaxB, vAxis.dot(v));
+      }
+      if (fMinB > fMaxA || fMaxB < fMinA) return false;
+    }
+    return true;
+  };
+
+  std::uniform_real_distribution<float> angle(0.0f, 6.28f);
+  for (int k = 0; k < 100; k++) {
+    const olc::vf2d vCentre = query.point();
+    const float w = query.size(query.rng) * (k % 10 == 0 ? 4 : 1), h = query.size(query.rng);
+    const float a = angle(query.rng);
+    const olc::vf2d vX = {std::cos(a), std::sin(a)}, vY = {-std::sin(a), std::cos(a)};
+    std::vector<olc::vf2d> vPolygon = {vCentre - vX * w - vY * h, vCentre + vX * w - vY * h,
+                                       vCentre + vX * w + vY * h, vCentre - vX * w + vY * h};
+    if (k % 3 == 0) vPolygon.pop_back();
+    if (k % 2 == 0) std::reverse(vPolygon.begin(), vPolygon.end());
+
+    std::vector<int> vWant, vFound, vFoundContainer;
+    for (auto const &item : vItems) if (overlaps(vPolygon, item.rArea)) vWant.push_back(item.nId);
+    std::sort(vWant.begin(), vWant.end());
+    tree.search_polygon(vPolygon, [&](int n) { vFound.push_back(n); });
+    container.search_polygon(vPolygon, [&](int &n) { vFoundContainer.push_back(n); });
+    CHECK(sorted(vFound) == vWant);
+    CHECK(sorted(vFoundContainer) == vWant);
+  }
+}
+
+static void test_batch_and_parallel() {
+  const auto vItems = random_items(50000, AREA, 1);
+  const auto vPairs = id_pairs(vItems);
+  RandomQueries query;
+
+  for (QuadTreeConfig config : {QuadTreeConfig{}, QuadTreeConfig{10, 8, 0.0f, 2.0f}}) {
+    StaticQuadTree<int> tree(0, rWorld, config);
+    tree.build(vPairs);
+    StaticQuadTreeContainer<int> container(vPairs, rWorld, 0, config);
+
+    for (size_t nQueries : {0, 1, 300, 5000}) {
+      std::vector<olc::rect> vQueries;
+      for (size_t i = 0; i < nQueries; i++) {
+        olc::rect rArea = query();
+        vQueries.push_back({rArea.pos, rArea.size / 10.0f});
+      }
+      StaticQuadTree<int>::BatchResult result;
+      tree.search_batch(vQueries, result, nQueries == 5000 ? 0 : 3);
+      CHECK(result.vOffsets.size() == nQueries + 1 && result.vHits.size() == result.vOffsets.back());
+      for (size_t i = 0; i < nQueries; i++) {
+        const std::span<const int> vHits(result.vHits.data() + result.vOffsets[i],
+                                         result.vOffsets[i + 1] - result.vOffsets[i]);
+        CHECK(sorted(vHits) == brute_search(vItems, vQueries[i]));
+      }
+      decltype(container)::BatchResult resultIds;
+      container.search_batch(vQueries, resultIds);
+      CHECK(resultIds.vOffsets == result.vOffsets);
+    }
+
+    for (int k = 0; k < 20; k++) {
+      const olc::rect rArea = k == 0 ? olc::rect({-1e5f, -1e5f}, {1e6f, 1e6f}) : query();
+      std::vector<int> vFound = {-7}; // searches append
+      tree.search_parallel(rArea, vFound, k % 3 == 0 ? 0 : 5);
+      CHECK(vFound[0] == -7);
+      vFound.erase(vFound.begin());
+      CHECK(sorted(vFound) == brute_search(vItems, rArea));
+      std::vector<uint32_t> vIds;
+      container.search_parallel(rArea, vIds, 3);
+      CHECK(vIds.size() == vFound.size());
+    }
+  }
+}
+
+static void test_pairs() {
+  for (QuadTreeConfig config : {QuadTreeConfig{}, QuadTreeConfig{8, 8}, QuadTreeConfig{10, 4, 0.0f, 2.0f}}) {
+    auto vItems = random_items(4000, AREA, 21);
+    vItems.push_back({{{-100.0f, -100.0f}, {300.0f, 300.0f}}, -5}); // sticks out of the tree's area
+    vItems.push_back({{{100.0f, 100.0f}, {0.0f, 0.0f}}, -6}); // empty, but still touches
+    const auto vPairs = id_pairs(vItems);
+
+    std::vector<std::pair<int, int>> vWant, vFound;
+    for (size_t i = 0; i < vItems.size(); i++) {
+      for (size_t j = i + 1; j < vItems.size(); j++)
+        if (touches(vItems[i].rArea, vItems[j].rArea)) vWant.push_back(std::minmax(vItems[i].nId, vItems[j].nId));
+    }
+    std::sort(vWant.begin(), vWant.end());
+
+    StaticQuadTree<int> tree(0, rWorld, config);
+    tree.build(vPairs);
+    tree.for_each_overlapping_pair([&](int a, int b) { vFound.push_back(std::minmax(a, b)); });
+    std::sort(vFound.begin(), vFound.end());
+    CHECK(!vWant.empty() && vFound == vWant);
+
+    StaticQuadTreeContainer<int> container(vPairs, rWorld, 0, config);
+    size_t nPairs = 0;
+    container.for_each_overlapping_pair([&](int &, int &) { nPairs++; });
+    CHECK(nPairs == vWant.size());
+  }
+}
+
+static void test_join() {
+  const olc::rect rOther = {{-1000.0f, -500.0f}, {AREA * 1.3f, AREA * 1.3f}};
+  for (int nVariant = 0; nVariant < 3; nVariant++) {
+    auto vMine = random_items(3000, AREA, 31), vTheirs = random_items(2500, AREA * 1.3f, 32);
+    vMine.push_back({{{-300.0f, -300.0f}, {500.0f, 500.0f}}, -1});
+    vTheirs.push_back({{{-250.0f, 100.0f}, {10.0f, 10.0f}}, -2});
+    for (auto &item : vTheirs) item.rArea.pos -= olc::vf2d(1000.0f, 500.0f);
+
+    // Trees of different depths and looseness over different areas
+    const QuadTreeConfig configMine = nVariant == 0 ? QuadTreeConfig{}
+        : nVariant == 1 ? QuadTreeConfig{6, 8} : QuadTreeConfig{10, 4, 0.0f, 2.0f};
+    const QuadTreeConfig configTheirs = nVariant == 0 ? QuadTreeConfig{10, 2, 0.0f, 1.5f}
+        : nVariant == 1 ? QuadTreeConfig{12, 1} : QuadTreeConfig{};
+    StaticQuadTree<int> mine(0, rWorld, configMine), theirs(0, rOther, configTheirs);
+    mine.build(id_pairs(vMine));
+    for (auto const &item : vTheirs) theirs.insert(item.nId, item.rArea);
+
+    std::vector<std::pair<int, int>> vWant, vFound;
+    for (auto const &a : vMine) {
+      for (auto const &b : vTheirs) if (touches(a.rArea, b.rArea)) vWant.push_back({a.nId, b.nId});
+    }
+    std::sort(vWant.begin(), vWant.end());
+    mine.join(theirs, [&](int a, int b) { vFound.push_back({a, b}); });
+    std::sort(vFound.begin(), vFound.end());
+    CHECK(!vWant.empty() && vFound == vWant);
+
+    StaticQuadTreeContainer<int> containerMine(id_pairs(vMine), rWorld, 0, configMine);
+    StaticQuadTreeContainer<int> containerTheirs(id_pairs(vTheirs), rOther, 0, configTheirs);
+    size_t nPairs = 0;
+    containerMine.join(containerTheirs, [&](int &, int &) { nPairs++; });
+    CHECK(nPairs == vWant.size());
+  }
+
+  // Trees of different item types
+  StaticQuadTree<int> a;
+  StaticQuadTree<double> b;
+  a.insert(1, {{1.0f, 1.0f}, {5.0f, 5.0f}});
+  b.insert(2.5, {{3.0f, 3.0f}, {5.0f, 5.0f}});
+  int nJoined = 0;
+  a.join(b, [&](const int &x, const double &y) { nJoined += (x == 1 && y == 2.5); });
+  CHECK(nJoined == 1);
+}
+
+int main() {
+  test_search();
+  test_linear();
+  test_parallel_build();
+  test_edits();
+  test_update_all();
+  test_container();
+  test_lod();
+  test_point_queries();
+  test_polygon();
+  test_batch_and_parallel();
+  test_pairs();
+  test_join();
+
+  if (nFailures > 0) {
+    std::fprintf(stderr, "%d checks failed\n", nFailures);
+    return 1;
+  }
+  std::printf("all checks passed\n");
+  return 0;
+}